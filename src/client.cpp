@@ -0,0 +1,90 @@
+// Small client for VehicleRouting's server mode, mostly for testing it locally.
+//
+// Usage: VehicleRoutingClient <socket_path> [budget_ms] <problem_file>
+//
+// Sends the problem file to the server and prints the schedules exactly like VehicleRouting itself would, so
+// it can stand in for it with evaluateShared.py, eg:
+//
+//   python3 evaluateShared.py --cmd "./build_release/VehicleRoutingClient /tmp/vr.sock 5000" --problemDir training/
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cout << "Usage: " << argv[0] << " <socket_path> [budget_ms] <problem_file>" << std::endl;
+        return 1;
+    }
+    std::string socket_path = argv[1];
+    std::string budget_ms = (argc > 3) ? argv[2] : "0";
+
+    std::ifstream infile(argv[argc - 1]);
+    if (!infile) {
+        std::cerr << "Unable to open " << argv[argc - 1] << std::endl;
+        return 1;
+    }
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(infile, line)) {
+        lines.push_back(line);
+    }
+
+    std::string request = "SOLVE " + budget_ms + " " + std::to_string(lines.size()) + "\n";
+    for (const auto& problem_line : lines) {
+        request += problem_line + "\n";
+    }
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::cerr << "Unable to connect to " << socket_path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    size_t written = 0;
+    while (written < request.size()) {
+        ssize_t count = ::write(fd, request.data() + written, request.size() - written);
+        if (count <= 0) {
+            std::cerr << "Unable to send request: " << std::strerror(errno) << std::endl;
+            ::close(fd);
+            return 1;
+        }
+        written += static_cast<size_t>(count);
+    }
+    // we only send the one request, so let the server know nothing else is coming
+    ::shutdown(fd, SHUT_WR);
+
+    std::string response;
+    char buffer[65536];
+    ssize_t count;
+    while ((count = ::read(fd, buffer, sizeof(buffer))) > 0) {
+        response.append(buffer, static_cast<size_t>(count));
+    }
+    ::close(fd);
+
+    std::stringstream ss(response);
+    std::string status;
+    std::getline(ss, status);
+    if (status.rfind("OK", 0) != 0) {
+        std::cerr << "Server responded with: " << status << std::endl;
+        return 1;
+    }
+    // stdout is just the schedules, everything else goes to stderr
+    std::cerr << status << std::endl;
+    while (std::getline(ss, line)) {
+        std::cout << line << std::endl;
+    }
+    return 0;
+}
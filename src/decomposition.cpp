@@ -0,0 +1,417 @@
+#include "decomposition.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "evaluate_shared.h"
+#include "exact_solver.h"
+#include "graph.h"
+
+struct Decomposition::WorkerState {
+    std::ofstream log;
+    std::mt19937 gen;
+    Graph graph;
+    Solver solver;
+    SolverResult result;
+
+    WorkerState(size_t index __attribute__((unused)), std::mt19937::result_type seed, long double max_minutes, long double target_gap)
+    : gen(seed)
+    , graph(std::vector<std::string>(), &log, max_minutes)
+    , solver(&gen, &log, max_minutes, target_gap) {
+        // clusters already get solved in parallel, a recombination thread each would oversubscribe the cores
+        solver.set_background_recombination(false);
+#if LOGGING
+        // one log per worker, otherwise clusters solved at the same time would interleave in the same file
+        log.open("debug-log-cluster-worker" + std::to_string(index) + ".out");
+#endif
+    }
+};
+
+namespace {
+
+long double midpoint_x(const Coordinate& coord) {
+    return (coord.pickupX + coord.dropOffX) / 2;
+}
+
+long double midpoint_y(const Coordinate& coord) {
+    return (coord.pickupY + coord.dropOffY) / 2;
+}
+
+// Angle of a load around HQ (which sits at the origin)
+long double load_angle(const Coordinate& coord) {
+    return std::atan2(midpoint_y(coord), midpoint_x(coord));
+}
+
+// Splits loads into num_chunks consecutive runs of (nearly) equal size, ordered by angle around HQ
+std::vector<std::vector<size_t>> split_by_angle(const std::vector<Coordinate>& coordinates, std::vector<size_t> loads, size_t num_chunks) {
+    std::vector<long double> angle(loads.size());
+    std::vector<size_t> order(loads.size());
+    for (size_t ii = 0; ii < loads.size(); ++ii) {
+        angle[ii] = load_angle(coordinates[loads[ii]]);
+        order[ii] = ii;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) { return angle[lhs] < angle[rhs]; });
+
+    std::vector<std::vector<size_t>> chunks(num_chunks);
+    for (size_t ii = 0; ii < order.size(); ++ii) {
+        chunks[ii * num_chunks / order.size()].push_back(loads[order[ii]]);
+    }
+    return chunks;
+}
+
+// Bound that doesn't need the distance matrix: every load costs at least its own pickup to dropoff minutes,
+// which takes at least enough drivers to fit them all, and every one of those drivers has to get from HQ to
+// some pickup and back from some dropoff
+long double weak_lower_bound(const std::vector<Coordinate>& coordinates, long double max_minutes) {
+    long double own_minutes = 0;
+    long double nearest_pickup = std::numeric_limits<long double>::infinity();
+    long double nearest_dropoff = std::numeric_limits<long double>::infinity();
+    for (size_t ii = 1; ii < coordinates.size(); ++ii) {
+        const Coordinate& coord = coordinates[ii];
+        own_minutes += EvaluateShared::distanceBetweenPoints(coord.pickupX, coord.pickupY, coord.dropOffX, coord.dropOffY);
+        nearest_pickup = std::min(nearest_pickup, EvaluateShared::distanceBetweenPoints(0, 0, coord.pickupX, coord.pickupY));
+        nearest_dropoff = std::min(nearest_dropoff, EvaluateShared::distanceBetweenPoints(coord.dropOffX, coord.dropOffY, 0, 0));
+    }
+    long double min_drivers = std::max(1.L, std::ceil(own_minutes / max_minutes));
+    return 500 * min_drivers + own_minutes + min_drivers * (nearest_pickup + nearest_dropoff);
+}
+
+}  // namespace
+
+Decomposition::Decomposition(std::mt19937* gen, long double max_minutes, long double target_gap, Method method,
+                             size_t cluster_size, bool repair, size_t num_threads)
+: _gen(gen)
+, _max_minutes(max_minutes)
+, _method(method)
+, _cluster_size(std::max<size_t>(1, cluster_size))
+, _repair(repair)
+, _deadline(std::chrono::steady_clock::time_point::max())
+, _pool(num_threads) {
+    for (size_t ii = 0; ii < _pool.size(); ++ii) {
+        _workers.push_back(std::make_unique<WorkerState>(ii, (*_gen)(), max_minutes, target_gap));
+    }
+}
+
+Decomposition::~Decomposition() = default;
+
+bool Decomposition::parse_method(const std::string& name, Method& method) {
+    if (name == "sweep") {
+        method = Method::Sweep;
+        return true;
+    }
+    if (name == "kmeans") {
+        method = Method::KMeans;
+        return true;
+    }
+    return false;
+}
+
+std::vector<std::vector<size_t>> Decomposition::cluster(const std::vector<Coordinate>& coordinates) {
+    size_t num_loads = coordinates.empty() ? 0 : coordinates.size() - 1;
+    if (num_loads == 0) {
+        return {};
+    }
+    size_t num_clusters = (num_loads + _cluster_size - 1) / _cluster_size;
+    auto clusters = (_method == Method::KMeans && num_clusters > 1) ? kmeans(coordinates, num_clusters) : sweep(coordinates, num_clusters);
+    clusters.erase(std::remove_if(clusters.begin(), clusters.end(), [](const std::vector<size_t>& loads) { return loads.empty(); }), clusters.end());
+    return clusters;
+}
+
+std::vector<std::vector<size_t>> Decomposition::sweep(const std::vector<Coordinate>& coordinates, size_t num_clusters) const {
+    std::vector<size_t> loads(coordinates.size() - 1);
+    std::iota(loads.begin(), loads.end(), 1);
+    return split_by_angle(coordinates, std::move(loads), num_clusters);
+}
+
+std::vector<std::vector<size_t>> Decomposition::kmeans(const std::vector<Coordinate>& coordinates, size_t num_clusters) {
+    const size_t kMaxIterations = 20;
+    size_t num_loads = coordinates.size() - 1;
+
+    // Starting from the sweep slices gives every centroid a sensible spot without any randomness
+    auto clusters = sweep(coordinates, num_clusters);
+    std::vector<long double> centroid_x(num_clusters, 0);
+    std::vector<long double> centroid_y(num_clusters, 0);
+    std::vector<size_t> assignment(coordinates.size(), 0);
+    for (size_t cc = 0; cc < num_clusters; ++cc) {
+        for (size_t load_id : clusters[cc]) {
+            assignment[load_id] = cc;
+        }
+    }
+
+    for (size_t iteration = 0; iteration < kMaxIterations; ++iteration) {
+        std::vector<size_t> count(num_clusters, 0);
+        std::fill(centroid_x.begin(), centroid_x.end(), 0);
+        std::fill(centroid_y.begin(), centroid_y.end(), 0);
+        for (size_t load_id = 1; load_id <= num_loads; ++load_id) {
+            centroid_x[assignment[load_id]] += midpoint_x(coordinates[load_id]);
+            centroid_y[assignment[load_id]] += midpoint_y(coordinates[load_id]);
+            ++count[assignment[load_id]];
+        }
+        for (size_t cc = 0; cc < num_clusters; ++cc) {
+            if (count[cc] > 0) {
+                centroid_x[cc] /= count[cc];
+                centroid_y[cc] /= count[cc];
+            } else {
+                // nobody's near this one, park it where it can't win anything
+                centroid_x[cc] = centroid_y[cc] = std::numeric_limits<long double>::infinity();
+            }
+        }
+
+        // The O(loads * clusters) part, split across the pool
+        size_t num_chunks = std::min(num_loads, 4 * _pool.size());
+        std::vector<char> changed(num_chunks, 0);
+        _pool.run_all(num_chunks, [&](size_t, size_t chunk) {
+            for (size_t load_id = 1 + chunk * num_loads / num_chunks; load_id <= (chunk + 1) * num_loads / num_chunks; ++load_id) {
+                long double x = midpoint_x(coordinates[load_id]);
+                long double y = midpoint_y(coordinates[load_id]);
+                size_t nearest = assignment[load_id];
+                long double nearest_distance = std::numeric_limits<long double>::infinity();
+                for (size_t cc = 0; cc < num_clusters; ++cc) {
+                    long double dx = x - centroid_x[cc];
+                    long double dy = y - centroid_y[cc];
+                    long double distance = dx*dx + dy*dy;
+                    if (distance < nearest_distance) {
+                        nearest_distance = distance;
+                        nearest = cc;
+                    }
+                }
+                if (nearest != assignment[load_id]) {
+                    assignment[load_id] = nearest;
+                    changed[chunk] = 1;
+                }
+            }
+        });
+        if (std::none_of(changed.begin(), changed.end(), [](char value) { return value != 0; })) {
+            break;
+        }
+    }
+
+    for (auto& loads : clusters) {
+        loads.clear();
+    }
+    for (size_t load_id = 1; load_id <= num_loads; ++load_id) {
+        clusters[assignment[load_id]].push_back(load_id);
+    }
+
+    // k-means doesn't care about cluster sizes, so cut down any cluster that came out far bigger than asked for,
+    // otherwise its sub-problem would take much longer than the rest
+    std::vector<std::vector<size_t>> balanced;
+    for (auto& loads : clusters) {
+        if (loads.size() > 2 * _cluster_size) {
+            size_t num_chunks = (loads.size() + _cluster_size - 1) / _cluster_size;
+            for (auto& chunk : split_by_angle(coordinates, std::move(loads), num_chunks)) {
+                balanced.push_back(std::move(chunk));
+            }
+        } else if (!loads.empty()) {
+            balanced.push_back(std::move(loads));
+        }
+    }
+
+    // Order by angle around HQ, so consecutive clusters are neighbours for the boundary repair
+    std::vector<long double> angle(balanced.size());
+    for (size_t cc = 0; cc < balanced.size(); ++cc) {
+        Coordinate center;
+        for (size_t load_id : balanced[cc]) {
+            center.pickupX += midpoint_x(coordinates[load_id]);
+            center.pickupY += midpoint_y(coordinates[load_id]);
+        }
+        center.dropOffX = center.pickupX;
+        center.dropOffY = center.pickupY;
+        angle[cc] = load_angle(center);
+    }
+    std::vector<size_t> order(balanced.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) { return angle[lhs] < angle[rhs]; });
+    std::vector<std::vector<size_t>> ordered;
+    ordered.reserve(balanced.size());
+    for (size_t cc : order) {
+        ordered.push_back(std::move(balanced[cc]));
+    }
+    return ordered;
+}
+
+bool Decomposition::solve_exactly(WorkerState& state, std::chrono::steady_clock::time_point deadline,
+                                  std::vector<std::vector<size_t>>& routes) const {
+    // Every worker might be running the exact solver at once, so they split its usual memory budget
+    size_t memory_limit_bytes = ExactSolver::kDefaultMemoryLimitBytes / _pool.size();
+    size_t num_loads = state.graph.numCoordinates() - 1;
+    if (!ExactSolver::fits(num_loads, memory_limit_bytes)) {
+        return false;
+    }
+    long long time_limit_ms = 10000;
+    if (deadline != std::chrono::steady_clock::time_point::max()) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        time_limit_ms = std::max<long long>(0, std::min<long long>(time_limit_ms, remaining.count()));
+    }
+
+    // The DP layers aren't split across _pool, this already runs on it
+    ExactSolver exact(&state.graph.getDistanceMatrix(), _max_minutes, &state.log, memory_limit_bytes, time_limit_ms);
+    routes.clear();
+    if (!exact.solve(routes) || EvaluateShared::validateSolutionSchedules(routes, state.graph.numCoordinates()) != 0) {
+        routes.clear();
+        return false;
+    }
+    return true;
+}
+
+void Decomposition::repair_boundary(const std::vector<Coordinate>& coordinates, size_t worker_index,
+                                    std::vector<std::vector<size_t>>& routes_a, std::vector<std::vector<size_t>>& routes_b) const {
+    WorkerState& state = *_workers[worker_index];
+
+    // Renumber both clusters' loads into one small problem, a's loads first
+    std::vector<Coordinate> local_coordinates(1, coordinates[0]);
+    std::vector<size_t> global_id(1, 0);
+    std::vector<std::vector<size_t>> local_routes;
+    for (auto* routes : {&routes_a, &routes_b}) {
+        for (const auto& route : *routes) {
+            local_routes.emplace_back();
+            for (size_t load_id : route) {
+                local_routes.back().push_back(global_id.size());
+                global_id.push_back(load_id);
+                local_coordinates.push_back(coordinates[load_id]);
+            }
+        }
+    }
+    size_t num_a_loads = 0;
+    for (const auto& route : routes_a) {
+        num_a_loads += route.size();
+    }
+
+    state.graph.reset(local_coordinates);
+    std::vector<size_t> loads_to_try(global_id.size() - 1);
+    std::iota(loads_to_try.begin(), loads_to_try.end(), 1);
+    state.graph.improve_schedule(loads_to_try, local_routes);
+
+    // Routes stay with whichever cluster most of their loads came from
+    routes_a.clear();
+    routes_b.clear();
+    for (const auto& route : local_routes) {
+        size_t from_a = std::count_if(route.begin(), route.end(), [&](size_t local_id) { return local_id <= num_a_loads; });
+        auto& routes = (2 * from_a >= route.size()) ? routes_a : routes_b;
+        routes.emplace_back();
+        for (size_t local_id : route) {
+            routes.back().push_back(global_id[local_id]);
+        }
+    }
+}
+
+int Decomposition::solve(const std::vector<Coordinate>& coordinates, SolverResult& result) {
+    result.solution.clear();
+    result.cost = 0;
+    result.gap = 0;
+    auto clusters = cluster(coordinates);
+    if (clusters.empty()) {
+        // No loads, so no drivers needed
+        return 0;
+    }
+
+    if (clusters.size() == 1) {
+        // Small enough to solve as a whole, which also gets us the real lower bound
+        WorkerState& state = *_workers[0];
+        state.graph.reset(coordinates);
+        state.solver.set_deadline(_deadline);
+        return state.solver.solve(state.graph, result);
+    }
+
+    // Solve every cluster on its own, mapping routes back to global load ids. With a deadline, each cluster gets
+    // a share of the time left in proportion to its loads (spread over the workers), so the first few clusters
+    // can't use up the whole budget and leave the rest with nothing. Some of it is held back for the repair.
+    std::vector<std::vector<std::vector<size_t>>> routes(clusters.size());
+    std::vector<int> status(clusters.size(), 0);
+    std::atomic<size_t> unstarted_loads(coordinates.size() - 1);
+    auto solve_deadline = _deadline;
+    if (_deadline != std::chrono::steady_clock::time_point::max() && _repair) {
+        auto start = std::chrono::steady_clock::now();
+        if (start < _deadline) {
+            solve_deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>((_deadline - start) * (1 - kRepairShare));
+        }
+    }
+    _pool.run_all(clusters.size(), [&](size_t worker_index, size_t cc) {
+        WorkerState& state = *_workers[worker_index];
+        std::vector<Coordinate> cluster_coordinates(1, coordinates[0]);
+        for (size_t load_id : clusters[cc]) {
+            cluster_coordinates.push_back(coordinates[load_id]);
+        }
+        state.graph.reset(cluster_coordinates);
+
+        size_t unstarted = unstarted_loads.fetch_sub(clusters[cc].size());
+        auto now = std::chrono::steady_clock::now();
+        auto cluster_deadline = solve_deadline;
+        if (solve_deadline != std::chrono::steady_clock::time_point::max() && now < solve_deadline) {
+            double share = std::min(1.0, static_cast<double>(_pool.size() * clusters[cc].size()) / unstarted);
+            cluster_deadline = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>((solve_deadline - now) * share);
+        }
+
+        if (now >= solve_deadline) {
+            // Out of time already, so no lower bound or search, just one greedy nearest load pass
+            Probs nearest(&state.gen, 0, 1, 0, 0, 0, false);
+            state.graph.plan_paths(nearest, state.result.solution);
+        } else if (solve_exactly(state, cluster_deadline, routes[cc])) {
+            for (auto& route : routes[cc]) {
+                for (size_t& load_id : route) {
+                    load_id = clusters[cc][load_id - 1];
+                }
+            }
+            return;
+        } else {
+            state.solver.set_deadline(cluster_deadline);
+            status[cc] = state.solver.solve(state.graph, state.result);
+            if (status[cc] != 0) {
+                return;
+            }
+        }
+        const Solution& solution = state.result.solution;
+        for (size_t rr = 0; rr < solution.numRoutes(); ++rr) {
+            routes[cc].emplace_back();
+            for (uint32_t local_id : solution.route(rr)) {
+                routes[cc].back().push_back(clusters[cc][local_id - 1]);
+            }
+        }
+    });
+    if (std::any_of(status.begin(), status.end(), [](int value) { return value != 0; })) {
+        return 1;
+    }
+
+    // Boundary repair over pairs of neighbouring clusters. Pairs in the same phase don't share a cluster, so
+    // they can run in parallel: (0,1) (2,3) ..., then (1,2) (3,4) ..., then the wraparound pair.
+    if (_repair) {
+        size_t num_clusters = clusters.size();
+        std::vector<std::vector<std::pair<size_t, size_t>>> phases(3);
+        for (size_t cc = 0; cc + 1 < num_clusters; ++cc) {
+            phases[cc % 2].emplace_back(cc, cc + 1);
+        }
+        if (num_clusters > 2) {
+            phases[2].emplace_back(num_clusters - 1, 0);
+        }
+        for (const auto& pairs : phases) {
+            if (std::chrono::steady_clock::now() >= _deadline) {
+                break;
+            }
+            _pool.run_all(pairs.size(), [&](size_t worker_index, size_t pp) {
+                repair_boundary(coordinates, worker_index, routes[pairs[pp].first], routes[pairs[pp].second]);
+            });
+        }
+    }
+
+    for (const auto& cluster_routes : routes) {
+        for (const auto& route : cluster_routes) {
+            result.solution.begin_route();
+            for (size_t load_id : route) {
+                result.solution.push_load(load_id);
+            }
+        }
+    }
+    if (EvaluateShared::validateSolutionSchedules(result.solution, coordinates.size()) != 0) {
+        return 1;
+    }
+    result.cost = EvaluateShared::getSolutionCost(coordinates, result.solution, _max_minutes);
+    if (result.cost == std::numeric_limits<long double>::infinity()) {
+        return 1;
+    }
+    long double bound = weak_lower_bound(coordinates, _max_minutes);
+    result.gap = std::max(0.L, (result.cost - bound) / result.cost);
+    return 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "coordinate.h"
+#include "solver.h"
+#include "thread_pool.h"
+
+// Cluster-first mode for instances too big to search as a whole. Loads are split into spatially coherent
+// clusters, each cluster is solved as its own small Graph (HQ plus that cluster's loads) with the exact solver
+// if it's small enough and the usual Solver otherwise,
+// all clusters in parallel on a ThreadPool, and the per-cluster schedules are merged into one solution. An
+// optional boundary repair pass then runs Graph::improve_schedule over each pair of neighbouring clusters, so
+// loads can move to a cheaper route across the boundary (and routes that empty out save their driver).
+//
+// Nothing here ever needs the full n x n distance matrix, only matrices for one cluster or a pair of them.
+class Decomposition {
+public:
+    enum class Method {
+        Sweep,   // sort loads by angle around HQ and cut into consecutive slices
+        KMeans,  // k-means on the midpoint between each load's pickup and dropoff
+    };
+
+    static constexpr size_t kDefaultClusterSize = 100;
+
+    // With a deadline and boundary repair, the clusters get all but this much of the time to solve in
+    static constexpr double kRepairShare = 0.1;
+
+    // num_threads of zero means one per hardware thread
+    Decomposition(std::mt19937* gen, long double max_minutes, long double target_gap, Method method,
+                  size_t cluster_size = kDefaultClusterSize, bool repair = true, size_t num_threads = 0);
+    ~Decomposition();
+
+    // Stop searching (merging whatever each cluster has so far) once this passes
+    void set_deadline(std::chrono::steady_clock::time_point deadline) {
+        _deadline = deadline;
+    }
+
+    // Solves the problem given by coordinates (coordinates[0] is HQ). Returns nonzero on trouble, zero if
+    // result holds a valid solution.
+    //
+    // With more than one cluster the gap in result is against a weak bound (every load's own pickup to dropoff
+    // minutes, plus enough drivers to cover those), since the usual LowerBound needs the full matrix.
+    int solve(const std::vector<Coordinate>& coordinates, SolverResult& result);
+
+    // Splits loads 1 thru coordinates.size()-1 into clusters of roughly cluster_size loads each, ordered by
+    // angle around HQ so that neighbouring clusters are next to each other
+    std::vector<std::vector<size_t>> cluster(const std::vector<Coordinate>& coordinates);
+
+    static bool parse_method(const std::string& name, Method& method);
+
+private:
+    struct WorkerState;
+
+    std::mt19937* _gen;
+    long double _max_minutes;
+    Method _method;
+    size_t _cluster_size;
+    bool _repair;
+    std::chrono::steady_clock::time_point _deadline;
+
+    std::vector<std::unique_ptr<WorkerState>> _workers;
+    ThreadPool _pool;
+
+    std::vector<std::vector<size_t>> sweep(const std::vector<Coordinate>& coordinates, size_t num_clusters) const;
+    std::vector<std::vector<size_t>> kmeans(const std::vector<Coordinate>& coordinates, size_t num_clusters);
+
+    // Solves the cluster in state's graph with the exact solver if it's small enough, into routes (local load
+    // ids), giving up at deadline. Returns false if it isn't, or the exact solver bailed.
+    bool solve_exactly(WorkerState& state, std::chrono::steady_clock::time_point deadline,
+                       std::vector<std::vector<size_t>>& routes) const;
+
+    // Relocates loads between the routes of clusters a and b (global load ids), see Graph::improve_schedule
+    void repair_boundary(const std::vector<Coordinate>& coordinates, size_t worker_index,
+                         std::vector<std::vector<size_t>>& routes_a, std::vector<std::vector<size_t>>& routes_b) const;
+};
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+
+#include "decomposition.h"
+#include "evaluate_shared.h"
+#include "test_instances.h"
+
+namespace {
+
+const long double kMaxMinutes = 12 * 60;
+const long double kTargetGap = 0.01;
+
+// Each of loads 1 through coordinates.size() - 1 exactly once, and every route doable in time
+void expect_valid_cover(const std::vector<Coordinate>& coordinates, const SolverResult& result) {
+    std::vector<size_t> covered;
+    for (size_t rr = 0; rr < result.solution.numRoutes(); ++rr) {
+        RouteView route = result.solution.route(rr);
+        EXPECT_GT(route.size(), 0u);
+        std::vector<size_t> loads(route.begin(), route.end());
+        EXPECT_LE(EvaluateShared::getSolutionCost(coordinates, std::vector<std::vector<size_t>>{loads}, kMaxMinutes),
+                  500 + kMaxMinutes);
+        covered.insert(covered.end(), loads.begin(), loads.end());
+    }
+    std::sort(covered.begin(), covered.end());
+    std::vector<size_t> expected(coordinates.size() - 1);
+    std::iota(expected.begin(), expected.end(), 1);
+    EXPECT_EQ(covered, expected);
+    EXPECT_EQ(EvaluateShared::validateSolutionSchedules(result.solution, coordinates.size()), 0);
+    EXPECT_NEAR(result.cost, EvaluateShared::getSolutionCost(coordinates, result.solution, kMaxMinutes), 1e-6);
+}
+
+// Clusters have to partition the loads, each one no bigger than twice what was asked for
+void expect_partition(const std::vector<Coordinate>& coordinates, const std::vector<std::vector<size_t>>& clusters, size_t cluster_size) {
+    std::vector<size_t> covered;
+    for (const auto& loads : clusters) {
+        EXPECT_FALSE(loads.empty());
+        EXPECT_LE(loads.size(), 2 * cluster_size);
+        covered.insert(covered.end(), loads.begin(), loads.end());
+    }
+    std::sort(covered.begin(), covered.end());
+    std::vector<size_t> expected(coordinates.size() - 1);
+    std::iota(expected.begin(), expected.end(), 1);
+    EXPECT_EQ(covered, expected);
+}
+
+}  // namespace
+
+TEST(DecompositionTests, ParseMethod) {
+    Decomposition::Method method = Decomposition::Method::Sweep;
+    EXPECT_TRUE(Decomposition::parse_method("kmeans", method));
+    EXPECT_EQ(method, Decomposition::Method::KMeans);
+    EXPECT_TRUE(Decomposition::parse_method("sweep", method));
+    EXPECT_EQ(method, Decomposition::Method::Sweep);
+    EXPECT_FALSE(Decomposition::parse_method("voronoi", method));
+}
+
+TEST(DecompositionTests, ClustersPartitionLoads) {
+    std::vector<Coordinate> coordinates = random_coordinates(11, 95, 125);
+    std::mt19937 gen(11);
+    for (auto method : {Decomposition::Method::Sweep, Decomposition::Method::KMeans}) {
+        Decomposition decomposition(&gen, kMaxMinutes, kTargetGap, method, 10, true, 1);
+        auto clusters = decomposition.cluster(coordinates);
+        EXPECT_GE(clusters.size(), 5u);
+        expect_partition(coordinates, clusters, 10);
+    }
+
+    // sweep slices come out (nearly) equal
+    Decomposition sweep(&gen, kMaxMinutes, kTargetGap, Decomposition::Method::Sweep, 10, true, 1);
+    auto clusters = sweep.cluster(coordinates);
+    ASSERT_EQ(clusters.size(), 10u);
+    for (const auto& loads : clusters) {
+        EXPECT_GE(loads.size(), 9u);
+        EXPECT_LE(loads.size(), 10u);
+    }
+
+    // nothing to split
+    EXPECT_TRUE(sweep.cluster(std::vector<Coordinate>(1)).empty());
+}
+
+TEST(DecompositionTests, SolveGivesValidCover) {
+    // clusters of 12 go to the exact solver, clusters of 40 to the usual Solver
+    std::vector<Coordinate> coordinates = random_coordinates(12, 80, 125);
+    for (auto method : {Decomposition::Method::Sweep, Decomposition::Method::KMeans}) {
+        for (size_t cluster_size : {12, 40}) {
+            std::mt19937 gen(12);
+            Decomposition decomposition(&gen, kMaxMinutes, kTargetGap, method, cluster_size, true, 1);
+            SolverResult result;
+            ASSERT_EQ(decomposition.solve(coordinates, result), 0);
+            expect_valid_cover(coordinates, result);
+            EXPECT_GE(result.gap, 0);
+            EXPECT_LT(result.gap, 1);
+        }
+    }
+}
+
+TEST(DecompositionTests, SingleClusterSolvesWhole) {
+    std::vector<Coordinate> coordinates = random_coordinates(13, 15, 125);
+    std::mt19937 gen(13);
+    Decomposition decomposition(&gen, kMaxMinutes, kTargetGap, Decomposition::Method::KMeans, 100, true, 1);
+    SolverResult result;
+    ASSERT_EQ(decomposition.solve(coordinates, result), 0);
+    expect_valid_cover(coordinates, result);
+
+    // and no loads needs no drivers
+    ASSERT_EQ(decomposition.solve(std::vector<Coordinate>(1), result), 0);
+    EXPECT_EQ(result.solution.numRoutes(), 0u);
+    EXPECT_EQ(result.cost, 0);
+}
+
+TEST(DecompositionTests, RepairNeverIncreasesCost) {
+    // exact clusters, so both runs merge the same per-cluster routes and only the repair differs
+    bool any_improved = false;
+    for (unsigned seed : {14, 15}) {
+        std::vector<Coordinate> coordinates = random_coordinates(seed, 60, 125);
+        for (auto method : {Decomposition::Method::Sweep, Decomposition::Method::KMeans}) {
+            std::mt19937 gen_without(seed);
+            Decomposition without(&gen_without, kMaxMinutes, kTargetGap, method, 10, false, 1);
+            SolverResult unrepaired;
+            ASSERT_EQ(without.solve(coordinates, unrepaired), 0);
+
+            std::mt19937 gen_with(seed);
+            Decomposition with(&gen_with, kMaxMinutes, kTargetGap, method, 10, true, 1);
+            SolverResult repaired;
+            ASSERT_EQ(with.solve(coordinates, repaired), 0);
+            expect_valid_cover(coordinates, repaired);
+            EXPECT_LE(repaired.cost, unrepaired.cost + 1e-6) << "seed " << seed;
+            any_improved = any_improved || (repaired.cost < unrepaired.cost - 1e-6);
+        }
+    }
+    // and it does actually find something across the boundaries
+    EXPECT_TRUE(any_improved);
+}
+
+TEST(DecompositionTests, PastDeadlineStillCovers) {
+    // no time for any cluster, each one just gets the greedy pass
+    std::vector<Coordinate> coordinates = random_coordinates(17, 120, 125);
+    std::mt19937 gen(17);
+    Decomposition decomposition(&gen, kMaxMinutes, kTargetGap, Decomposition::Method::Sweep, 30, true, 1);
+    decomposition.set_deadline(std::chrono::steady_clock::now());
+    SolverResult result;
+    ASSERT_EQ(decomposition.solve(coordinates, result), 0);
+    expect_valid_cover(coordinates, result);
+    // still far better than a driver per load
+    EXPECT_LT(result.solution.numRoutes(), coordinates.size() / 2);
+}
@@ -0,0 +1,80 @@
+#include "distance_matrix.h"
+
+#include <algorithm>
+#include <cstring>
+
+DistanceMatrix::DistanceMatrix(const DistanceMatrix& other)
+: _data(nullptr)
+, _size(0)
+, _stride(0) {
+    *this = other;
+}
+
+DistanceMatrix& DistanceMatrix::operator=(const DistanceMatrix& other) {
+    if (this == &other) {
+        return *this;
+    }
+    if (other.attached()) {
+        // both can share the external buffer
+        _data = other._data;
+        _size = other._size;
+        _stride = other._stride;
+        return *this;
+    }
+    _storage = other._storage;
+    _data = _storage.data();
+    _size = other._size;
+    _stride = other._stride;
+    return *this;
+}
+
+void DistanceMatrix::assign(size_t size) {
+    _storage.assign(size * size, 0);
+    _data = _storage.data();
+    _size = size;
+    _stride = size;
+}
+
+void DistanceMatrix::attach(const double* data, size_t size) {
+    _data = data;
+    _size = size;
+    _stride = size;
+}
+
+double* DistanceMatrix::mutable_row(size_t from) {
+    if (attached()) {
+        make_owned(_stride);
+    }
+    return _storage.data() + from * _stride;
+}
+
+void DistanceMatrix::grow() {
+    if (attached() || _size + 1 > _stride) {
+        // an eighth more rather than double, the buffer is stride squared so doubling would quadruple the memory
+        make_owned(std::max<size_t>(_size + 1, _stride + std::max<size_t>(16, _stride / 8)));
+    }
+    ++_size;
+    // the new row and column may hold leftovers from an earlier shrink()
+    std::fill(_storage.begin() + (_size - 1) * _stride, _storage.begin() + (_size - 1) * _stride + _size, 0.);
+    for (size_t from = 0; from + 1 < _size; ++from) {
+        _storage[from * _stride + _size - 1] = 0;
+    }
+}
+
+void DistanceMatrix::shrink() {
+    if (_size == 0) {
+        return;
+    }
+    // nothing moves, the last row and column just stop being part of the matrix
+    --_size;
+}
+
+void DistanceMatrix::make_owned(size_t stride) {
+    std::vector<double> storage(stride * stride, 0);
+    for (size_t from = 0; from < _size; ++from) {
+        std::memcpy(storage.data() + from * stride, _data + from * _stride, _size * sizeof(double));
+    }
+    _storage.swap(storage);
+    _data = _storage.data();
+    _stride = stride;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Square matrix of minutes between loads, stored flat and row major. matrix[from][to] reads like the old
+// vector<vector> did, but the whole thing is one contiguous buffer.
+//
+// The buffer is either owned, or attached to memory somebody else owns (eg a memory mapped instance file),
+// in which case it's used in place without copying. Anything that modifies an attached matrix copies it into
+// owned storage first.
+class DistanceMatrix {
+public:
+    DistanceMatrix()
+    : _data(nullptr)
+    , _size(0)
+    , _stride(0) {}
+
+    DistanceMatrix(const DistanceMatrix& other);
+    DistanceMatrix& operator=(const DistanceMatrix& other);
+
+    size_t size() const {
+        return _size;
+    }
+
+    bool empty() const {
+        return _size == 0;
+    }
+
+    const double* operator[](size_t from) const {
+        return _data + from * _stride;
+    }
+
+    // Resizes to size x size owned storage filled with zeros, reusing the existing buffer if it's big enough
+    void assign(size_t size);
+
+    // Uses a size x size row major buffer in place. data has to stay valid until the next assign/attach.
+    void attach(const double* data, size_t size);
+
+    bool attached() const {
+        return _size > 0 && _data != _storage.data();
+    }
+
+    // Writable row, copying an attached matrix into owned storage first
+    double* mutable_row(size_t from);
+
+    // Row length of the underlying buffer, at least size()
+    size_t stride() const {
+        return _stride;
+    }
+
+    // Adds a row and column of zeros at the end. Rows are padded out to a stride that grows by an eighth as
+    // needed, so this is O(n) amortized rather than a full copy each time.
+    void grow();
+
+    // Drops the last row and column
+    void shrink();
+
+private:
+    std::vector<double> _storage;
+    const double* _data;
+    size_t _size;
+    size_t _stride;
+
+    void make_owned(size_t stride);
+};
@@ -1,31 +1,84 @@
 #include "evaluate_shared.h"
 
-#include <unordered_set>
 #include <iostream>
 #include <limits>
 #include <vector>
 
+namespace {
+
+template <typename Schedule>
+long double distanceOfSchedule(const Schedule& schedule, const std::vector<Coordinate>& coordinates) {
+    long double distance = 0;
+    long double currentX = 0;
+    long double currentY = 0;
+    for (size_t loadId : schedule) {
+        const Coordinate& load = coordinates[loadId];
+        // to pickup
+        distance += EvaluateShared::distanceBetweenPoints(currentX, currentY, load.pickupX, load.pickupY);
+        currentX = load.pickupX;
+        currentY = load.pickupY;
+        // to dropoff
+        distance += EvaluateShared::distanceBetweenPoints(currentX, currentY, load.dropOffX, load.dropOffY);
+        currentX = load.dropOffX;
+        currentY = load.dropOffY;
+    }
+    distance += EvaluateShared::distanceBetweenPoints(currentX, currentY, 0, 0);
+    return distance;
+}
+
+template <typename Schedule>
+void outputSchedule(std::ostream& out, const Schedule& schedule) {
+    out << "[";
+    bool seenFirst = false;
+    for (size_t loadId : schedule) {
+        if (seenFirst) {
+            out << ",";
+        }
+        out << loadId;
+        seenFirst = true;
+    }
+    out << "]" << std::endl;
+}
+
+}  // namespace
+
 int EvaluateShared::validateSolutionSchedules(const std::vector<std::vector<size_t>>& solutionSchedules, size_t numCoordinates) {
+    Solution solution;
+    solution.assign(solutionSchedules);
+    return validateSolutionSchedules(solution, numCoordinates);
+}
+
+int EvaluateShared::validateSolutionSchedules(const Solution& solution, size_t numCoordinates) {
+    std::vector<char> seen;
+    return validateSolutionSchedules(solution, numCoordinates, seen);
+}
+
+int EvaluateShared::validateSolutionSchedules(const Solution& solution, size_t numCoordinates, std::vector<char>& seen) {
     size_t numLoads = numCoordinates - 1;   // HQ isn't a load, but all other coordinates are
 
-    std::unordered_set<size_t> solutionLoadIds;
-    for (const auto& schedule : solutionSchedules) {
-        for (size_t loadId : schedule) {
-            if (solutionLoadIds.find(loadId) != solutionLoadIds.end()) {
+    // load ids are dense, so a flat array of flags beats a hash set (and assign() keeps the buffer)
+    seen.assign(numCoordinates, 0);
+    for (size_t ii = 0; ii < solution.numRoutes(); ++ii) {
+        for (uint32_t loadId : solution.route(ii)) {
+            if (loadId == 0 || loadId >= numCoordinates) {
+                // not a load we know about, so the load count can't add up
+                return 1;
+            }
+            if (seen[loadId]) {
                 // load loadId was included in at least two driver schedules
                 return 2;
             }
-            solutionLoadIds.insert(loadId);
+            seen[loadId] = 1;
         }
     }
 
-    if (solutionLoadIds.size() != numLoads) {
+    if (solution.numLoads() != numLoads) {
         // the solution load count isn't equal to the known load count (ie numLoads)
         return 1;
     }
 
     for (size_t loadId = 1; loadId <= numLoads; ++loadId) {
-        if (solutionLoadIds.find(loadId) == solutionLoadIds.end()) {
+        if (!seen[loadId]) {
             // load loadId was not assigned to a driver
             return 3;
         }
@@ -35,67 +88,57 @@ int EvaluateShared::validateSolutionSchedules(const std::vector<std::vector<size
     return 0;
 }
 
+long double EvaluateShared::getDistanceOfScheduleWithReturnHome(const std::vector<size_t>& schedule, const std::vector<Coordinate>& coordinates) {
+    return distanceOfSchedule(schedule, coordinates);
+}
 
-long double EvaluateShared::getDistanceOfScheduleWithReturnHome(const std::vector<size_t>& schedule, const std::vector<Coordinate>& coordinates)
-{
-    long double distance = 0;
-    long double currentX = 0;
-    long double currentY = 0;
-    for (size_t loadId : schedule) {
-        const Coordinate& load = coordinates[loadId];
-        // to pickup
-        distance += distanceBetweenPoints(currentX, currentY, load.pickupX, load.pickupY);
-        currentX = load.pickupX;
-        currentY = load.pickupY;
-        // to dropoff
-        distance += distanceBetweenPoints(currentX, currentY, load.dropOffX, load.dropOffY);
-        currentX = load.dropOffX;
-        currentY = load.dropOffY;
-    }
-    distance += distanceBetweenPoints(currentX, currentY, 0, 0);
-    return distance;
+long double EvaluateShared::getDistanceOfScheduleWithReturnHome(const RouteView& schedule, const std::vector<Coordinate>& coordinates) {
+    return distanceOfSchedule(schedule, coordinates);
 }
 
 long double EvaluateShared::getSolutionCost(const std::vector<Coordinate>& coordinates, const std::vector<std::vector<size_t>>& solutionSchedules, long double maxMinutes) {
+    Solution solution;
+    solution.assign(solutionSchedules);
+    return getSolutionCost(coordinates, solution, maxMinutes);
+}
+
+long double EvaluateShared::getSolutionCost(const std::vector<Coordinate>& coordinates, const Solution& solution, long double maxMinutes) {
     long double totalDrivenMinutes = 0;
-    for (size_t ii = 0; ii < solutionSchedules.size(); ++ii) {
-        const auto& schedule = solutionSchedules[ii];
-        long double scheduleMinutes = getDistanceOfScheduleWithReturnHome(schedule, coordinates);
+    for (size_t ii = 0; ii < solution.numRoutes(); ++ii) {
+        long double scheduleMinutes = getDistanceOfScheduleWithReturnHome(solution.route(ii), coordinates);
         if (scheduleMinutes > maxMinutes) {
             // TODO: error, log it here!!!
             return std::numeric_limits<long double>::infinity();
         }
         totalDrivenMinutes += scheduleMinutes;
     }
-    return 500.L*solutionSchedules.size() + totalDrivenMinutes;
+    return 500.L*solution.numRoutes() + totalDrivenMinutes;
 }
 
 void EvaluateShared::outputSolutionSchedules(const std::vector<std::vector<size_t>>& solutionSchedules) {
+    outputSolutionSchedules(std::cout, solutionSchedules);
+}
+
+void EvaluateShared::outputSolutionSchedules(std::ostream& out, const std::vector<std::vector<size_t>>& solutionSchedules) {
     for (const auto& schedule : solutionSchedules) {
-        std::cout << "[";
-        bool seenFirst = false;
-        for (size_t loadId : schedule) {
-            if (seenFirst) {
-                std::cout << ",";
-            }
-            std::cout << loadId;
-            seenFirst = true;
-        }
-        std::cout << "]" << std::endl;
+        outputSchedule(out, schedule);
     }
 }
 
-void EvaluateShared::outputScheduleToLog(std::ofstream* log, const std::vector<std::vector<size_t>>& solutionSchedules) {
-    for (const auto& schedule : solutionSchedules) {
-        *log << "[";
-        bool seenFirst = false;
-        for (size_t loadId : schedule) {
-            if (seenFirst) {
-                *log << ",";
-            }
-            *log << loadId;
-            seenFirst = true;
-        }
-        *log << "]" << std::endl;
+void EvaluateShared::outputSolutionSchedules(const Solution& solution) {
+    outputSolutionSchedules(std::cout, solution);
+}
+
+void EvaluateShared::outputSolutionSchedules(std::ostream& out, const Solution& solution) {
+    for (size_t ii = 0; ii < solution.numRoutes(); ++ii) {
+        outputSchedule(out, solution.route(ii));
     }
 }
+
+void EvaluateShared::outputScheduleToLog(std::ofstream* log, const std::vector<std::vector<size_t>>& solutionSchedules) {
+    outputSolutionSchedules(*log, solutionSchedules);
+}
+
+void EvaluateShared::outputScheduleToLog(std::ofstream* log, const Solution& solution) {
+    outputSolutionSchedules(*log, solution);
+}
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "coordinate.h"
+#include "solution.h"
 
 class EvaluateShared {
 public:
@@ -21,19 +22,34 @@ public:
     // trouble, zero if validation passes.
     static int validateSolutionSchedules(const std::vector<std::vector<size_t>>& solutionSchedules, size_t numCoordinates);
 
+    // Same as above, but for a flat Solution
+    static int validateSolutionSchedules(const Solution& solution, size_t numCoordinates);
+
+    // Same as above, but keeping track of which loads were seen in scratch (any contents, it gets overwritten),
+    // so calling it for every candidate with the same scratch doesn't allocate. This is the one the search uses.
+    static int validateSolutionSchedules(const Solution& solution, size_t numCoordinates, std::vector<char>& scratch);
+
     // Redundant method due to lack of time figuring out CPython.
     //
     // Compare with getDistanceOfScheduleWithReturnHome() method in evaluateShared.py
     static long double getDistanceOfScheduleWithReturnHome(const std::vector<size_t>& schedule, const std::vector<Coordinate>& coordinates);
+    static long double getDistanceOfScheduleWithReturnHome(const RouteView& schedule, const std::vector<Coordinate>& coordinates);
 
     // Redundant method due to lack of time figuring out CPython.
     //
     // Compare with getSolutionCost() method in evaluateShared.py, except returns Infinity on error
     // (because that's a large number and we want to minimize the solution cost)
     static long double getSolutionCost(const std::vector<Coordinate>& coordinates, const std::vector<std::vector<size_t>>& solutionSchedules, long double maxMinutes);
+    static long double getSolutionCost(const std::vector<Coordinate>& coordinates, const Solution& solution, long double maxMinutes);
 
     // Outputs a claimed solutionSchedules in the manner we expect evaluateShared.py to see it in 
     static void outputSolutionSchedules(const std::vector<std::vector<size_t>>& solutionSchedules);
 
+    // Same as above, but to any stream (eg a server response) instead of stdout
+    static void outputSolutionSchedules(std::ostream& out, const std::vector<std::vector<size_t>>& solutionSchedules);
+    static void outputSolutionSchedules(const Solution& solution);
+    static void outputSolutionSchedules(std::ostream& out, const Solution& solution);
+
     static void outputScheduleToLog(std::ofstream* log, const std::vector<std::vector<size_t>>& solutionSchedules);
+    static void outputScheduleToLog(std::ofstream* log, const Solution& solution);
 };
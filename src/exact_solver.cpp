@@ -0,0 +1,247 @@
+#include "exact_solver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+namespace {
+
+const double kInfinity = std::numeric_limits<double>::infinity();
+
+// Gosper's hack: the next larger mask with the same number of bits set
+uint32_t next_same_popcount(uint32_t mask) {
+    uint32_t low = mask & (~mask + 1);
+    uint32_t ripple = mask + low;
+    return (((ripple ^ mask) >> 2) / low) | ripple;
+}
+
+}  // namespace
+
+size_t ExactSolver::memory_needed(size_t num_loads) {
+    size_t num_masks = size_t(1) << num_loads;
+    // Held-Karp table, plus route cost, partition cost, and partition choice per mask
+    return num_masks * (num_loads * sizeof(double) + sizeof(double) + sizeof(double) + sizeof(uint32_t));
+}
+
+bool ExactSolver::fits(size_t num_loads, size_t memory_limit_bytes) {
+    return num_loads <= kMaxLoads && memory_needed(num_loads) <= memory_limit_bytes;
+}
+
+bool ExactSolver::solve(std::vector<std::vector<size_t>>& solution) {
+    std::vector<size_t> loads;
+    for (size_t ii = 1; ii < _distance_matrix->size(); ++ii) {
+        loads.push_back(ii);
+    }
+    return solve(loads, solution);
+}
+
+template <typename Fn>
+bool ExactSolver::sweep_layer(size_t num_bits, size_t popcount, Fn fn) {
+    std::vector<uint32_t> masks;
+    uint32_t limit = uint32_t(1) << num_bits;
+    for (uint32_t mask = (uint32_t(1) << popcount) - 1; mask < limit; mask = next_same_popcount(mask)) {
+        masks.push_back(mask);
+    }
+
+    // Not worth handing tiny layers to the pool
+    const size_t min_masks_per_task = 4096;
+    size_t num_tasks = _pool ? std::min(4 * _pool->size(), masks.size() / min_masks_per_task) : 1;
+    num_tasks = std::max<size_t>(1, num_tasks);
+
+    std::atomic<bool> timed_out(false);
+    auto sweep_chunk = [&](size_t, size_t task_index) {
+        size_t begin = task_index * masks.size() / num_tasks;
+        size_t end = (task_index + 1) * masks.size() / num_tasks;
+        for (size_t ii = begin; ii < end; ++ii) {
+            // checking the clock every mask is wasteful, so only do so every so often
+            if (((ii - begin) & 1023) == 0 && (timed_out.load(std::memory_order_relaxed) || std::chrono::steady_clock::now() > _deadline)) {
+                timed_out = true;
+                return;
+            }
+            fn(masks[ii]);
+        }
+    };
+
+    if (num_tasks == 1) {
+        sweep_chunk(0, 0);
+    } else {
+        _pool->run_all(num_tasks, sweep_chunk);
+    }
+    return !timed_out;
+}
+
+bool ExactSolver::solve(const std::vector<size_t>& loads, std::vector<std::vector<size_t>>& solution) {
+    size_t n = loads.size();
+    if (n == 0) {
+        solution.clear();
+        return true;
+    }
+    if (!fits(n, _memory_limit_bytes)) {
+#if LOGGING
+        *_log << "ExactSolver: " << n << " loads is too many to solve exactly" << std::endl;
+#endif
+        return false;
+    }
+    _deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_time_limit_ms);
+
+    // Copy the distances we care about into a small flat table. Index 0 is HQ, index ii+1 is loads[ii].
+    size_t width = n + 1;
+    std::vector<double> dist(width * width, 0);
+    for (size_t from = 0; from < width; ++from) {
+        size_t from_id = (from == 0) ? 0 : loads[from - 1];
+        for (size_t to = 0; to < width; ++to) {
+            size_t to_id = (to == 0) ? 0 : loads[to - 1];
+            dist[from * width + to] = (*_distance_matrix)[from_id][to_id];
+        }
+    }
+    double max_minutes = static_cast<double>(_max_minutes);
+    size_t num_masks = size_t(1) << n;
+
+    // path[mask * n + last] is the fewest minutes to leave HQ and do every load in mask, finishing with last.
+    // We only keep paths that can still make it back to HQ in time. Any path that can't won't be able to once
+    // more loads are tacked on either (triangle inequality), so infeasible paths are pruned right away.
+    std::vector<double> path(num_masks * n, kInfinity);
+    // route[mask] is the fewest minutes for a single driver to do every load in mask and return to HQ
+    std::vector<double> route(num_masks, kInfinity);
+
+    for (size_t ii = 0; ii < n; ++ii) {
+        uint32_t mask = uint32_t(1) << ii;
+        double minutes = dist[ii + 1];
+        double round_trip = minutes + dist[(ii + 1) * width];
+        if (round_trip <= max_minutes) {
+            path[mask * n + ii] = minutes;
+            route[mask] = round_trip;
+        }
+    }
+
+    for (size_t popcount = 2; popcount <= n; ++popcount) {
+        bool finished = sweep_layer(n, popcount, [&](uint32_t mask) {
+            double* row = &path[size_t(mask) * n];
+            double best_route = kInfinity;
+            for (uint32_t bits = mask; bits; bits &= bits - 1) {
+                size_t last = __builtin_ctz(bits);
+                uint32_t prev_mask = mask ^ (uint32_t(1) << last);
+                if (route[prev_mask] == kInfinity) {
+                    continue;
+                }
+                const double* prev_row = &path[size_t(prev_mask) * n];
+                double best = kInfinity;
+                for (uint32_t prev_bits = prev_mask; prev_bits; prev_bits &= prev_bits - 1) {
+                    size_t prev = __builtin_ctz(prev_bits);
+                    double minutes = prev_row[prev] + dist[(prev + 1) * width + last + 1];
+                    if (minutes < best) {
+                        best = minutes;
+                    }
+                }
+                double round_trip = best + dist[(last + 1) * width];
+                if (round_trip <= max_minutes) {
+                    row[last] = best;
+                    best_route = std::min(best_route, round_trip);
+                }
+            }
+            route[mask] = best_route;
+        });
+        if (!finished) {
+#if LOGGING
+            *_log << "ExactSolver: ran out of time building routes for " << n << " loads" << std::endl;
+#endif
+            return false;
+        }
+    }
+
+    // best[mask] is the cheapest cost (500 per driver plus minutes) to cover every load in mask, and pick[mask]
+    // is the route used for the lowest load in mask to get there. Fixing the lowest load to be in the picked
+    // route means each partition gets enumerated once instead of once per ordering of its routes.
+    std::vector<double> best(num_masks, kInfinity);
+    std::vector<uint32_t> pick(num_masks, 0);
+    best[0] = 0;
+
+    for (size_t popcount = 1; popcount <= n; ++popcount) {
+        bool finished = sweep_layer(n, popcount, [&](uint32_t mask) {
+            uint32_t low = mask & (~mask + 1);
+            uint32_t rest = mask ^ low;
+            double best_cost = kInfinity;
+            uint32_t best_pick = 0;
+            for (uint32_t sub = rest;; sub = (sub - 1) & rest) {
+                uint32_t chosen = sub | low;
+                if (route[chosen] != kInfinity) {
+                    double cost = 500. + route[chosen] + best[mask ^ chosen];
+                    if (cost < best_cost) {
+                        best_cost = cost;
+                        best_pick = chosen;
+                    }
+                }
+                if (sub == 0) {
+                    break;
+                }
+            }
+            best[mask] = best_cost;
+            pick[mask] = best_pick;
+        });
+        if (!finished) {
+#if LOGGING
+            *_log << "ExactSolver: ran out of time partitioning " << n << " loads" << std::endl;
+#endif
+            return false;
+        }
+    }
+
+    uint32_t full = static_cast<uint32_t>(num_masks - 1);
+    if (best[full] == kInfinity) {
+        // Some load can't be done by a driver on its own within max_minutes, no solution exists
+#if LOGGING
+        *_log << "ExactSolver: no feasible partition exists" << std::endl;
+#endif
+        return false;
+    }
+
+#if LOGGING
+    *_log << "ExactSolver: optimal cost for " << n << " loads is " << best[full] << std::endl;
+#endif
+
+    solution.clear();
+    for (uint32_t mask = full; mask; mask ^= pick[mask]) {
+        solution.push_back(rebuild_route(loads, dist, path, pick[mask]));
+    }
+    return true;
+}
+
+std::vector<size_t> ExactSolver::rebuild_route(const std::vector<size_t>& loads, const std::vector<double>& dist, const std::vector<double>& path, uint32_t route_mask) {
+    size_t n = loads.size();
+    size_t width = n + 1;
+
+    // Find the load the route finishes on
+    size_t last = n;
+    double best = kInfinity;
+    for (uint32_t bits = route_mask; bits; bits &= bits - 1) {
+        size_t candidate = __builtin_ctz(bits);
+        double round_trip = path[size_t(route_mask) * n + candidate] + dist[(candidate + 1) * width];
+        if (round_trip < best) {
+            best = round_trip;
+            last = candidate;
+        }
+    }
+
+    // Then repeatedly find the predecessor that produced the path ending at last
+    std::vector<size_t> reversed;
+    uint32_t mask = route_mask;
+    while (true) {
+        reversed.push_back(loads[last]);
+        mask ^= uint32_t(1) << last;
+        if (mask == 0) {
+            break;
+        }
+        size_t prev_last = n;
+        double prev_best = kInfinity;
+        for (uint32_t bits = mask; bits; bits &= bits - 1) {
+            size_t candidate = __builtin_ctz(bits);
+            double minutes = path[size_t(mask) * n + candidate] + dist[(candidate + 1) * width + last + 1];
+            if (minutes < prev_best) {
+                prev_best = minutes;
+                prev_last = candidate;
+            }
+        }
+        last = prev_last;
+    }
+    return std::vector<size_t>(reversed.rbegin(), reversed.rend());
+}
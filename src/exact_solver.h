@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#include "distance_matrix.h"
+#include "thread_pool.h"
+
+// Exact solver for small instances (or small sub-problems of larger instances).
+//
+// Works in two phases over bitmasks of the loads being solved:
+//   1. Held-Karp DP: for every subset of loads, the minimum minutes a single driver needs to leave HQ,
+//      do every load in the subset, and return to HQ. Subsets that can't be done within max_minutes are
+//      marked infeasible (and pruned, since adding loads never makes a route shorter).
+//   2. Partition DP: the cheapest way to split the full set of loads into feasible driver routes, where
+//      each route costs 500 plus its minutes.
+//
+// Both DP's are swept one popcount layer at a time, since every mask only depends on masks with fewer
+// bits set, which lets each layer be split up across a thread pool.
+class ExactSolver {
+public:
+    // Hard cap on the number of loads, the Held-Karp table alone is (2^n * n) doubles
+    static constexpr size_t kMaxLoads = 20;
+
+    static constexpr size_t kDefaultMemoryLimitBytes = 512ull * 1024 * 1024;
+
+    ExactSolver(const DistanceMatrix* distance_matrix, long double max_minutes, std::ofstream* log,
+                size_t memory_limit_bytes = kDefaultMemoryLimitBytes, long long time_limit_ms = 10000)
+    : _distance_matrix(distance_matrix)
+    , _max_minutes(max_minutes)
+    , _log(log)
+    , _memory_limit_bytes(memory_limit_bytes)
+    , _time_limit_ms(time_limit_ms)
+    , _pool(nullptr) {}
+
+    // Splits big DP layers across pool, which mustn't be the pool running the caller (see ThreadPool::run_all).
+    // nullptr (the default) sweeps everything on the calling thread.
+    void set_thread_pool(ThreadPool* pool) {
+        _pool = pool;
+    }
+
+    // Whether num_loads is small enough to be solved exactly within memory_limit_bytes
+    static bool fits(size_t num_loads, size_t memory_limit_bytes = kDefaultMemoryLimitBytes);
+
+    // Solves for every load in the distance matrix (ie loads 1 thru n). Returns false (leaving solution
+    // untouched) if the instance is too big, or if the time limit ran out before the DP's finished.
+    bool solve(std::vector<std::vector<size_t>>& solution);
+
+    // Same as above, but only for the given load ids, so we can solve sub-problems of larger instances
+    bool solve(const std::vector<size_t>& loads, std::vector<std::vector<size_t>>& solution);
+
+private:
+    const DistanceMatrix* _distance_matrix;
+    long double _max_minutes;
+    std::ofstream* _log;
+    size_t _memory_limit_bytes;
+    long long _time_limit_ms;
+    ThreadPool* _pool;
+    std::chrono::steady_clock::time_point _deadline;
+
+    static size_t memory_needed(size_t num_loads);
+
+    // Runs fn(mask) for every mask with popcount bits set out of num_bits, split across the pool. Returns
+    // false if the deadline passed while sweeping.
+    template <typename Fn>
+    bool sweep_layer(size_t num_bits, size_t popcount, Fn fn);
+
+    // Walks the Held-Karp table backwards to recover the visiting order of the loads in route_mask
+    std::vector<size_t> rebuild_route(const std::vector<size_t>& loads, const std::vector<double>& dist, const std::vector<double>& path, uint32_t route_mask);
+};
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include "evaluate_shared.h"
+#include "exact_solver.h"
+#include "graph.h"
+#include "test_instances.h"
+#include "thread_pool.h"
+
+namespace {
+
+const long double kMaxMinutes = 12 * 60;
+
+std::ofstream test_log;  // never opened, so logging goes nowhere
+
+// Cheapest way to do loads, by trying every order of them and every way of cutting that order into routes
+double brute_force_cost(const DistanceMatrix& matrix, std::vector<size_t> loads) {
+    std::sort(loads.begin(), loads.end());
+    size_t n = loads.size();
+    double best = std::numeric_limits<double>::infinity();
+    do {
+        // bit ii of cuts set means a new route starts after the ii-th load in this order
+        for (uint32_t cuts = 0; cuts < (uint32_t(1) << (n - 1)); ++cuts) {
+            double cost = 0;
+            std::vector<size_t> route;
+            for (size_t ii = 0; ii < n && cost < best; ++ii) {
+                route.push_back(loads[ii]);
+                if (ii + 1 == n || (cuts & (uint32_t(1) << ii))) {
+                    double minutes = route_minutes(matrix, route);
+                    cost = (minutes <= kMaxMinutes) ? cost + 500 + minutes : std::numeric_limits<double>::infinity();
+                    route.clear();
+                }
+            }
+            best = std::min(best, cost);
+        }
+    } while (std::next_permutation(loads.begin(), loads.end()));
+    return best;
+}
+
+double matrix_cost(const DistanceMatrix& matrix, const std::vector<std::vector<size_t>>& routes) {
+    double cost = 0;
+    for (const auto& route : routes) {
+        cost += 500 + route_minutes(matrix, route);
+    }
+    return cost;
+}
+
+}  // namespace
+
+TEST(ExactSolverTests, MatchesBruteForceOnSmallInstances) {
+    for (uint32_t seed = 1; seed <= 6; ++seed) {
+        Graph graph({}, &test_log, kMaxMinutes);
+        // spread out enough that not everything fits in one route
+        graph.reset(random_coordinates(seed, 7, 125));
+        ExactSolver exact(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+        std::vector<std::vector<size_t>> routes;
+        ASSERT_TRUE(exact.solve(routes));
+        ASSERT_EQ(EvaluateShared::validateSolutionSchedules(routes, graph.numCoordinates()), 0);
+        EXPECT_LT(EvaluateShared::getSolutionCost(graph.getCoordinates(), routes, kMaxMinutes), std::numeric_limits<long double>::infinity());
+
+        std::vector<size_t> loads(7);
+        std::iota(loads.begin(), loads.end(), 1);
+        EXPECT_NEAR(matrix_cost(graph.getDistanceMatrix(), routes), brute_force_cost(graph.getDistanceMatrix(), loads), 1e-6) << "seed " << seed;
+    }
+}
+
+TEST(ExactSolverTests, SolvesSubProblems) {
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(42, 12, 125));
+    std::vector<size_t> subset = {2, 5, 7, 9, 11, 12};
+    ExactSolver exact(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+    std::vector<std::vector<size_t>> routes;
+    ASSERT_TRUE(exact.solve(subset, routes));
+
+    std::vector<size_t> covered;
+    for (const auto& route : routes) {
+        EXPECT_LE(route_minutes(graph.getDistanceMatrix(), route), kMaxMinutes);
+        covered.insert(covered.end(), route.begin(), route.end());
+    }
+    std::sort(covered.begin(), covered.end());
+    EXPECT_EQ(covered, subset);
+    EXPECT_NEAR(matrix_cost(graph.getDistanceMatrix(), routes), brute_force_cost(graph.getDistanceMatrix(), subset), 1e-6);
+}
+
+TEST(ExactSolverTests, ThreadPoolGivesTheSameCost) {
+    // 16 loads is enough for the middle DP layers to get split across the pool
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(7, 16));
+    ExactSolver serial(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+    std::vector<std::vector<size_t>> serial_routes;
+    ASSERT_TRUE(serial.solve(serial_routes));
+
+    ThreadPool pool(4);
+    ExactSolver parallel(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+    parallel.set_thread_pool(&pool);
+    std::vector<std::vector<size_t>> parallel_routes;
+    ASSERT_TRUE(parallel.solve(parallel_routes));
+    EXPECT_NEAR(matrix_cost(graph.getDistanceMatrix(), serial_routes), matrix_cost(graph.getDistanceMatrix(), parallel_routes), 1e-6);
+}
+
+TEST(ExactSolverTests, RefusesInstancesThatDontFit) {
+    EXPECT_FALSE(ExactSolver::fits(ExactSolver::kMaxLoads + 1));
+    EXPECT_FALSE(ExactSolver::fits(16, 1024));
+    EXPECT_TRUE(ExactSolver::fits(10));
+}
@@ -1,6 +1,7 @@
 #include <bits/stdc++.h> 
 
 #include "evaluate_shared.h"
+#include "masked_argmin.h"
 
 #include "graph.h"
 
@@ -9,6 +10,84 @@ void Graph::build() {
     build_distance_matrix();
 }
 
+void Graph::reset(const std::vector<std::string>& lines) {
+    _lines.assign(lines.begin(), lines.end());
+    build();
+    _instance.reset();
+}
+
+void Graph::reset(const std::vector<Coordinate>& coordinates) {
+    _lines.clear();
+    _coordinates.assign(coordinates.begin(), coordinates.end());
+    build_distance_matrix();
+    _instance.reset();
+}
+
+void Graph::reset(const std::shared_ptr<const InstanceFile>& instance) {
+    _lines.clear();
+    _coordinates = instance->getCoordinates();
+    if (instance->getDistanceMatrix()) {
+        _distance_matrix.attach(instance->getDistanceMatrix(), _coordinates.size());
+    } else {
+        build_distance_matrix();
+    }
+    _instance = instance;
+}
+
+int Graph::load(const std::string& path, std::string& error, bool verify_matrix_checksum) {
+    if (InstanceFile::is_instance_file(path)) {
+        std::shared_ptr<const InstanceFile> instance = InstanceFile::open(path, verify_matrix_checksum, error);
+        if (!instance) {
+            return 1;
+        }
+        reset(instance);
+        return 0;
+    }
+
+    std::vector<std::string> lines;
+    if (read_lines(path, lines, error) != 0) {
+        return 1;
+    }
+    reset(lines);
+    return 0;
+}
+
+int Graph::load_coordinates(const std::string& path, std::string& error) {
+    _instance.reset();
+    _distance_matrix.assign(0);
+    if (InstanceFile::is_instance_file(path)) {
+        // no point mapping in a matrix we're not going to use
+        std::shared_ptr<const InstanceFile> instance = InstanceFile::open(path, /* verify_matrix_checksum = */ false, error);
+        if (!instance) {
+            return 1;
+        }
+        _lines.clear();
+        _coordinates = instance->getCoordinates();
+        return 0;
+    }
+
+    if (read_lines(path, _lines, error) != 0) {
+        return 1;
+    }
+    build_coordinates();
+    return 0;
+}
+
+int Graph::read_lines(const std::string& path, std::vector<std::string>& lines, std::string& error) {
+    std::ifstream infile(path);
+    if (!infile) {
+        error = "unable to open " + path;
+        return 1;
+    }
+    std::string line;
+    lines.clear();
+    while (std::getline(infile, line))
+    {
+        lines.push_back(line);
+    }
+    return 0;
+}
+
 void Graph::debug() {
     _log->precision(20);
     *_log << "Lines: " << std::endl;
@@ -24,12 +103,13 @@ void Graph::debug() {
 }
 
 void Graph::build_coordinates() {
+    _coordinates.clear();
     if (_lines.size() < 2) {
         // There's no graph to build. We need at least 2 lines to build a graph
         return;
     }
 
-    _coordinates = std::vector(_lines.size(), Coordinate());
+    _coordinates.assign(_lines.size(), Coordinate());
 
     for (size_t ii = 1; ii < _lines.size(); ++ii) {
         std::string line = _lines[ii];
@@ -108,9 +188,8 @@ void Graph::build_coordinates() {
 }
 
 void Graph::build_distance_matrix() {
-    for (size_t ii = 0; ii < _coordinates.size(); ++ii) {
-        _distance_matrix.push_back(std::vector<long double>(_coordinates.size(), 0));
-    }
+    // assign() reuses the existing buffer, so rebuilding for a similar sized problem doesn't allocate
+    _distance_matrix.assign(_coordinates.size());
 
     for (size_t to_load = 0; to_load < _coordinates.size(); ++to_load) {
         const Coordinate* to_coord = &_coordinates[to_load];
@@ -126,54 +205,57 @@ void Graph::build_distance_matrix() {
             // ie matrix[from_load][to_load] is the total distance traveled after finishing at from_load to performing ALL work of to_load immediately after
 
             long double switch_from_to = EvaluateShared::distanceBetweenPoints(from_coord->dropOffX, from_coord->dropOffY, to_coord->pickupX, to_coord->pickupY);
-            _distance_matrix[from_load][to_load] = switch_from_to + to_load_pickup_dropoff_distance;
+            _distance_matrix.mutable_row(from_load)[to_load] = switch_from_to + to_load_pickup_dropoff_distance;
         }
     }
 }
 
-std::vector<std::vector<size_t>> Graph::plan_paths(Probs& probs) {
+void Graph::plan_paths(Probs& probs, Solution& solution) {
 #if LOGGING
     *_log << "Running plan_paths with: " << probs.to_string() << std::endl;
 #endif
 
-    std::unordered_set<size_t> loads;
-    for (size_t ii = 1; ii < _coordinates.size(); ++ii) {
-        loads.insert(ii);
+    // _available[load_id] is nonzero while a load still needs a driver. HQ (load id 0) never does.
+    _available.assign(_coordinates.size(), 1);
+    size_t remaining_loads = 0;
+    if (!_available.empty()) {
+        _available[0] = 0;
+        remaining_loads = _coordinates.size() - 1;
     }
 
-    std::vector<std::vector<size_t>> solution;
-    while (!loads.empty()) {
-        std::vector<size_t> path = plan_path_for_driver(loads, probs);
-        if (path.empty()) {
+    solution.clear();
+    while (remaining_loads > 0) {
+        // the driver's path goes straight onto the end of solution
+        solution.begin_route();
+        size_t path_length = plan_path_for_driver(probs, solution);
+        if (path_length == 0) {
             // Should not happen, indicates a problem...
-            return std::vector<std::vector<size_t>>();
-        }
-        // add path to solution
-        solution.push_back(path);
-        // remove everything in path from loads
-        for (size_t item : path) {
-            loads.erase(item);
+            solution.clear();
+            return;
         }
+        remaining_loads -= path_length;
     }
-    return solution;
 }
 
-std::vector<size_t> Graph::plan_path_for_driver(const std::unordered_set<size_t>& candidate_loads, Probs& probs) {
+size_t Graph::plan_path_for_driver(Probs& probs, Solution& solution) {
 #if LOGGING
     *_log << "Running plan_path_for_driver with loads: ";
-    for (size_t load_id : candidate_loads) {
-        *_log << load_id << ", ";
+    for (size_t load_id = 1; load_id < _available.size(); ++load_id) {
+        if (_available[load_id]) {
+            *_log << load_id << ", ";
+        }
     }
     *_log << std::endl;
 #endif
 
-    std::unordered_set<size_t> loads = candidate_loads;
-    const std::vector<long double>* hq_distances = &_distance_matrix[0];
+    const double* hq_distances = _distance_matrix[0];
     size_t current_load = 0; // we start at HQ
-    std::vector<size_t> fallback;  // this is always a solution that gets us back within the _max_minutes
+    // The route being built in solution is cumulative, ie where we want to explore so far if possible. Note we might not be able to return
+    // to HQ & only detect if AFTER visiting a node. The fallback is always a prefix of cumulative, so rather than copying it, we only track
+    // its length and truncate back to it at the end.
+    size_t fallback_length = 0;  // this is always a solution that gets us back within the _max_minutes
     long double fallback_minutes __attribute__((unused)) = 0;  // variable may be unread, but we still want to track it - corresponds to fallback
 
-    std::vector<size_t> cumulative;  // where we want to explore so far if possible. Note we might not be able to return to HQ & only detect if AFTER visiting a node
     long double cumulative_minutes = 0; // minutes for the solution
 
     while (cumulative_minutes < _max_minutes) {
@@ -182,15 +264,15 @@ std::vector<size_t> Graph::plan_path_for_driver(const std::unordered_set<size_t>
         *_log << "Cumulative minutes: " << cumulative_minutes << std::endl;
 #endif
 
-        const std::vector<long double>* current_distances = &_distance_matrix[current_load];
+        const double* current_distances = _distance_matrix[current_load];
 
         // Check if we can return to HQ from where we're at. If yes, that's the new fallback
         // solution in case we later make a cumulative that cannot proceed (due to returning
         // to HQ exceeding max_minutes)
-        bool canReturnToHq = (cumulative_minutes + current_distances->at(0) < _max_minutes);
+        bool canReturnToHq = (cumulative_minutes + current_distances[0] < _max_minutes);
         if (canReturnToHq) {
-            fallback = cumulative;
-            fallback_minutes = cumulative_minutes + current_distances->at(0);
+            fallback_length = solution.last_route_length();
+            fallback_minutes = cumulative_minutes + current_distances[0];
 
 #if LOGGING
             *_log << "Can return to hq from current_node, updating fallback" << std::endl;
@@ -198,20 +280,17 @@ std::vector<size_t> Graph::plan_path_for_driver(const std::unordered_set<size_t>
 #endif
         }
 
-        // For the loadId's in loads, none of which are HQ, and NONE of which match current_load, only consider loadId's we can reach from the current_load without exceeding max_minutes
-        std::unordered_set<size_t> reachable_loads;
-        for (size_t loadId : loads) {
-            if ((loadId != current_load) && cumulative_minutes + current_distances->at(loadId) < _max_minutes) {
-                reachable_loads.insert(loadId);
-            }
-        }
+        // Only loads still available (which excludes HQ and current_load) that we can reach from the current_load without exceeding max_minutes
+        // count as reachable. The nearest of those is needed for the emptiness check anyway, and it's exactly what GreedyNearest picks.
+        double budget = static_cast<double>(_max_minutes - cumulative_minutes);
+        size_t nearest_load = masked_argmin(current_distances, nullptr, _available.data(), _available.size(), budget);
 
-        // Do we have any new reachable_loads to take on? If not, use the fallback.
-        if (reachable_loads.empty()) {
+        // Do we have any new reachable loads to take on? If not, use the fallback.
+        if (nearest_load == 0) {
 #if LOGGING
             *_log << "No more reachable loads, using fallback" << std::endl;
 #endif
-            return fallback;
+            return finish_route(solution, fallback_length);
         }
 
         // select a scheme, note the if current_load is 0 (aka HQ), then we avoid returning home, aka probHome is ignored. Otherwise probHome is considered.
@@ -226,11 +305,29 @@ std::vector<size_t> Graph::plan_path_for_driver(const std::unordered_set<size_t>
 #if LOGGING
             *_log << "Unknown scheme chosen, using fallback" << std::endl;
 #endif
-            return fallback;
+            return finish_route(solution, fallback_length);
         }
 
-        // pick a next_load to visit
-        size_t next_load = probs.implement_scheme_and_select_next_load(scheme, reachable_loads, current_distances, hq_distances);
+        // pick a next_load to visit. The greedy schemes are a single pass of masked_argmin() over the distance row, the others need
+        // the reachable loads listed out.
+        size_t next_load = 0;
+        if (scheme == Scheme::GreedyNearest) {
+            next_load = nearest_load;
+        } else if (scheme == Scheme::OnwayNearest) {
+            // Onway nearest is a node that's closer to us than HQ. If all nodes are closer to HQ, we fallback to regular nearest
+            next_load = masked_argmin(current_distances, hq_distances, _available.data(), _available.size(), budget);
+            if (next_load == 0) {
+                next_load = nearest_load;
+            }
+        } else {
+            _reachable_loads.clear();
+            for (size_t load_id = 1; load_id < _available.size(); ++load_id) {
+                if (_available[load_id] && current_distances[load_id] < budget) {
+                    _reachable_loads.push_back(load_id);
+                }
+            }
+            next_load = probs.implement_scheme_and_select_next_load(scheme, _reachable_loads, current_distances, hq_distances);
+        }
 
 #if LOGGING
         *_log << "Next load has been chosen to be: " << next_load << std::endl;
@@ -239,14 +336,14 @@ std::vector<size_t> Graph::plan_path_for_driver(const std::unordered_set<size_t>
         // next_load got chosen, update cumulative, cumulative_minutes, loads, and current_load
         if (next_load != 0) {
             // We have a new load to consider for the driver's path, update the cumulative stats, then update loads and current_load
-            cumulative.push_back(next_load);
-            cumulative_minutes += current_distances->at(next_load);
+            solution.push_load(next_load);
+            cumulative_minutes += current_distances[next_load];
 
-            loads.erase(next_load);
+            _available[next_load] = 0;
             current_load = next_load;
         } else {
             // We got instructed to go to HQ after visiting a series of non-HQ nodes. Don't update cumulative (it's implied) or loads (which doesn't have zero), but do update the cumulative_minutes and current_load. This means the path for the driver is done
-            cumulative_minutes += current_distances->at(next_load);
+            cumulative_minutes += current_distances[next_load];
             current_load = next_load;
             break;
         }
@@ -256,7 +353,7 @@ std::vector<size_t> Graph::plan_path_for_driver(const std::unordered_set<size_t>
     // (if we're already at HQ, then _distance_matrix[current_load][0] is zero). If we CAN return to HQ, that's our new fallback, otherwise,
     // keep existing fallback path
     if ((cumulative_minutes < _max_minutes) && (cumulative_minutes + _distance_matrix[current_load][0] < _max_minutes)) {
-        fallback = cumulative;
+        fallback_length = solution.last_route_length();
         fallback_minutes = cumulative_minutes + _distance_matrix[current_load][0];
 
 #if LOGGING
@@ -271,5 +368,226 @@ std::vector<size_t> Graph::plan_path_for_driver(const std::unordered_set<size_t>
 #if LOGGING
     *_log << "Iterated as far as we can go w this driver, outputting the fallback path that's within max minutes" << std::endl;
 #endif
-    return fallback;
+    return finish_route(solution, fallback_length);
+}
+
+size_t Graph::finish_route(Solution& solution, size_t length) {
+    // anything past the fallback goes back up for grabs
+    RouteView route = solution.route(solution.numRoutes() - 1);
+    for (size_t position = length; position < route.size(); ++position) {
+        _available[route.loads[position]] = 1;
+    }
+    solution.truncate_route(length);
+    return length;
+}
+
+double Graph::leg_minutes(const Coordinate& from, const Coordinate& to) {
+    long double switch_from_to = EvaluateShared::distanceBetweenPoints(from.dropOffX, from.dropOffY, to.pickupX, to.pickupY);
+    long double to_pickup_dropoff_distance = EvaluateShared::distanceBetweenPoints(to.pickupX, to.pickupY, to.dropOffX, to.dropOffY);
+    return switch_from_to + to_pickup_dropoff_distance;
+}
+
+long double Graph::route_minutes(const std::vector<size_t>& route) const {
+    long double minutes = 0;
+    size_t current_load = 0;
+    for (size_t load_id : route) {
+        minutes += _distance_matrix[current_load][load_id];
+        current_load = load_id;
+    }
+    return minutes + _distance_matrix[current_load][0];
+}
+
+size_t Graph::add_load(const Coordinate& coordinate) {
+    if (_coordinates.empty()) {
+        // HQ always has to be there
+        _coordinates.push_back(Coordinate());
+        _distance_matrix.assign(1);
+    }
+
+    size_t load_id = _coordinates.size();
+    _coordinates.push_back(coordinate);
+
+    _distance_matrix.grow();
+
+    // new column, ie HQ and every existing load to the new load
+    for (size_t from_load = 0; from_load < load_id; ++from_load) {
+        _distance_matrix.mutable_row(from_load)[load_id] = leg_minutes(_coordinates[from_load], coordinate);
+    }
+
+    // new row, ie the new load to HQ and every existing load
+    double* row = _distance_matrix.mutable_row(load_id);
+    for (size_t to_load = 0; to_load < load_id; ++to_load) {
+        row[to_load] = leg_minutes(coordinate, _coordinates[to_load]);
+    }
+
+#if LOGGING
+    *_log << "Added load " << load_id << std::endl;
+#endif
+    return load_id;
+}
+
+size_t Graph::remove_load(size_t load_id) {
+    if (load_id == 0 || load_id >= _coordinates.size()) {
+        // HQ can't be removed, and there's nothing to do for loads that don't exist
+        return load_id;
+    }
+
+    // Move the highest load into load_id's slot, so only one row and one column need patching, then drop the last
+    size_t last_load = _coordinates.size() - 1;
+    if (load_id != last_load) {
+        _coordinates[load_id] = _coordinates[last_load];
+        std::copy(_distance_matrix[last_load], _distance_matrix[last_load] + last_load, _distance_matrix.mutable_row(load_id));
+        for (size_t from_load = 0; from_load < last_load; ++from_load) {
+            double* row = _distance_matrix.mutable_row(from_load);
+            row[load_id] = row[last_load];
+        }
+        // the copied row had load_id's old entry where its own diagonal now is
+        _distance_matrix.mutable_row(load_id)[load_id] = 0;
+    }
+    _coordinates.pop_back();
+    _distance_matrix.shrink();
+
+#if LOGGING
+    *_log << "Removed load " << load_id << ", load " << last_load << " is now load " << load_id << std::endl;
+#endif
+    return last_load;
+}
+
+size_t Graph::add_load_to_schedule(const Coordinate& coordinate, std::vector<std::vector<size_t>>& schedules) {
+    size_t load_id = add_load(coordinate);
+
+    // Find the cheapest feasible place to insert the load. Going between from and to instead of straight there
+    // costs d[from][load] + d[load][to] - d[from][to] extra minutes.
+    long double best_extra = 500.L + _distance_matrix[0][load_id] + _distance_matrix[load_id][0];
+    size_t best_route = schedules.size();
+    size_t best_position = 0;
+    for (size_t route_index = 0; route_index < schedules.size(); ++route_index) {
+        const auto& route = schedules[route_index];
+        long double minutes = route_minutes(route);
+        for (size_t position = 0; position <= route.size(); ++position) {
+            size_t from_load = (position == 0) ? 0 : route[position - 1];
+            size_t to_load = (position == route.size()) ? 0 : route[position];
+            long double extra = _distance_matrix[from_load][load_id] + _distance_matrix[load_id][to_load] - _distance_matrix[from_load][to_load];
+            if (extra < best_extra && minutes + extra <= _max_minutes) {
+                best_extra = extra;
+                best_route = route_index;
+                best_position = position;
+            }
+        }
+    }
+
+    if (best_route == schedules.size()) {
+        // a new driver is cheaper (or nothing else has room)
+        schedules.push_back({load_id});
+    } else {
+        schedules[best_route].insert(schedules[best_route].begin() + best_position, load_id);
+    }
+
+    std::vector<size_t> loads_to_try = schedules[best_route];
+    improve_schedule(loads_to_try, schedules);
+    return load_id;
+}
+
+void Graph::remove_load_from_schedule(size_t load_id, std::vector<std::vector<size_t>>& schedules) {
+    size_t moved_load = remove_load(load_id);
+
+    std::vector<size_t> loads_to_try;
+    for (auto& route : schedules) {
+        auto it = std::find(route.begin(), route.end(), load_id);
+        if (it != route.end()) {
+            route.erase(it);
+            // the rest of this route just got cheaper, and may now have room for loads from elsewhere (or could
+            // be spread out over other routes to save a driver)
+            loads_to_try.insert(loads_to_try.end(), route.begin(), route.end());
+        }
+    }
+    // renumber the load that remove_load() moved into load_id's slot
+    for (auto& route : schedules) {
+        for (size_t& id : route) {
+            if (id == moved_load) {
+                id = load_id;
+            }
+        }
+    }
+    for (size_t& id : loads_to_try) {
+        if (id == moved_load) {
+            id = load_id;
+        }
+    }
+    schedules.erase(std::remove_if(schedules.begin(), schedules.end(), [](const std::vector<size_t>& route) { return route.empty(); }), schedules.end());
+
+    improve_schedule(loads_to_try, schedules);
+}
+
+void Graph::improve_schedule(const std::vector<size_t>& loads_to_try, std::vector<std::vector<size_t>>& schedules, size_t max_rounds) {
+    std::vector<long double> minutes(schedules.size());
+    for (size_t route_index = 0; route_index < schedules.size(); ++route_index) {
+        minutes[route_index] = route_minutes(schedules[route_index]);
+    }
+    std::vector<size_t> route_of(_coordinates.size(), schedules.size());
+    for (size_t route_index = 0; route_index < schedules.size(); ++route_index) {
+        for (size_t load_id : schedules[route_index]) {
+            route_of[load_id] = route_index;
+        }
+    }
+
+    for (size_t round = 0; round < max_rounds; ++round) {
+        bool improved = false;
+        for (size_t load_id : loads_to_try) {
+            size_t from_route = route_of[load_id];
+            if (from_route == schedules.size()) {
+                continue;
+            }
+            auto& route = schedules[from_route];
+            size_t position = std::find(route.begin(), route.end(), load_id) - route.begin();
+            size_t prev_load = (position == 0) ? 0 : route[position - 1];
+            size_t next_load = (position + 1 == route.size()) ? 0 : route[position + 1];
+
+            // what taking the load out of its route saves, including the driver if it's their only load
+            long double saved = (route.size() == 1)
+                ? 500.L + minutes[from_route]
+                : _distance_matrix[prev_load][load_id] + _distance_matrix[load_id][next_load] - _distance_matrix[prev_load][next_load];
+
+            long double best_extra = saved;
+            size_t best_route = schedules.size();
+            size_t best_position = 0;
+            for (size_t to_route = 0; to_route < schedules.size(); ++to_route) {
+                const auto& other = schedules[to_route];
+                if (to_route == from_route || other.empty()) {
+                    continue;
+                }
+                for (size_t other_position = 0; other_position <= other.size(); ++other_position) {
+                    size_t from_load = (other_position == 0) ? 0 : other[other_position - 1];
+                    size_t to_load = (other_position == other.size()) ? 0 : other[other_position];
+                    long double extra = _distance_matrix[from_load][load_id] + _distance_matrix[load_id][to_load] - _distance_matrix[from_load][to_load];
+                    if (extra < best_extra - 1e-9L && minutes[to_route] + extra <= _max_minutes) {
+                        best_extra = extra;
+                        best_route = to_route;
+                        best_position = other_position;
+                    }
+                }
+            }
+            if (best_route == schedules.size()) {
+                continue;
+            }
+
+            // relocate it
+            route.erase(route.begin() + position);
+            minutes[from_route] = route.empty() ? 0 : minutes[from_route] - saved;
+            auto& other = schedules[best_route];
+            other.insert(other.begin() + best_position, load_id);
+            minutes[best_route] += best_extra;
+            route_of[load_id] = best_route;
+            improved = true;
+
+#if LOGGING
+            *_log << "Moved load " << load_id << " from route " << from_route << " to route " << best_route << std::endl;
+#endif
+        }
+        if (!improved) {
+            break;
+        }
+    }
+
+    schedules.erase(std::remove_if(schedules.begin(), schedules.end(), [](const std::vector<size_t>& route) { return route.empty(); }), schedules.end());
 }
@@ -1,13 +1,17 @@
 #pragma once
 
 #include <fstream>
+#include <cstdint>
+#include <memory>
 #include <random>
 #include <string>
-#include <unordered_set>
 #include <vector>
 
 #include "coordinate.h"
+#include "distance_matrix.h"
+#include "instance_file.h"
 #include "scheme.h"
+#include "solution.h"
 
 class Graph {
 public:
@@ -18,9 +22,55 @@ public:
 
     void build();
 
+    // Rebuild this graph for a different problem. Buffers from the previous problem are reused rather than
+    // reallocated where possible, which matters when one Graph serves many requests in server mode.
+    void reset(const std::vector<std::string>& lines);
+
+    // Same as above, but from coordinates directly rather than text lines. coordinates[0] is HQ.
+    void reset(const std::vector<Coordinate>& coordinates);
+
+    // Same as above, but from a binary instance file. If the file has a distance matrix, it's used in place
+    // (the Graph keeps the file mapped for as long as it needs it) instead of being rebuilt.
+    void reset(const std::shared_ptr<const InstanceFile>& instance);
+
+    // Resets from a problem file, either a binary instance file or the usual text format. Returns nonzero (with
+    // the reason in error) on trouble. verify_matrix_checksum reads a binary file's whole distance matrix in up
+    // front to check it, rather than trusting it (only the coordinates get checked otherwise).
+    int load(const std::string& path, std::string& error, bool verify_matrix_checksum = false);
+
+    // Like load(), but stops after the coordinates and leaves the distance matrix empty. Meant for instances
+    // too big for an n x n matrix, where only getCoordinates() gets used (eg to split the problem into
+    // clusters, see decomposition.h). Nothing that needs the matrix works until the next reset().
+    int load_coordinates(const std::string& path, std::string& error);
+
     void debug();
 
-    std::vector<std::vector<size_t>> plan_paths(Probs& probs);
+    // Builds a candidate solution into solution (clearing whatever was there). Solution keeps its buffers
+    // between calls, so reusing one for every candidate avoids allocating per candidate.
+    void plan_paths(Probs& probs, Solution& solution);
+
+    // Incremental updates, for when loads come and go after a schedule was already built. Each of these patches
+    // one row and one column of the distance matrix in O(n) instead of rebuilding everything. Note that _lines
+    // isn't updated, so a later build() or debug() only knows about the original loads.
+
+    // Adds a new load, returning its load id (always the new highest id)
+    size_t add_load(const Coordinate& coordinate);
+
+    // Removes a load. Load ids need to stay contiguous, so the highest load id gets renumbered to load_id.
+    // Returns the old id of that renumbered load (which is load_id itself if it was already the highest).
+    size_t remove_load(size_t load_id);
+
+    // Adds a new load and repairs schedules to include it, by cheapest feasible insertion (or a new driver if
+    // that's cheaper or nothing else fits), followed by a bounded local improvement. Returns the new load id.
+    size_t add_load_to_schedule(const Coordinate& coordinate, std::vector<std::vector<size_t>>& schedules);
+
+    // Removes a load and repairs schedules to match, including the renumbering done by remove_load(), followed
+    // by a bounded local improvement
+    void remove_load_from_schedule(size_t load_id, std::vector<std::vector<size_t>>& schedules);
+
+    // Tries relocating each of the given loads to the cheapest feasible spot in another route, keeping any move
+    // that lowers the cost (including when it empties out a route, saving a driver), for up to max_rounds passes
+    void improve_schedule(const std::vector<size_t>& loads_to_try, std::vector<std::vector<size_t>>& schedules, size_t max_rounds = 3);
 
     size_t numCoordinates() const {
         return _coordinates.size();
@@ -30,16 +80,38 @@ public:
         return _coordinates;
     }
 
+    const DistanceMatrix& getDistanceMatrix() const {
+        return _distance_matrix;
+    }
+
 private:
+    static int read_lines(const std::string& path, std::vector<std::string>& lines, std::string& error);
+
     void build_coordinates();
     void build_distance_matrix();
 
-    std::vector<size_t> plan_path_for_driver(const std::unordered_set<size_t>& loads, Probs& probs);
+    // Minutes from finishing from's dropoff to finishing to's dropoff, ie what _distance_matrix[from][to] holds
+    static double leg_minutes(const Coordinate& from, const Coordinate& to);
+
+    // Minutes for a driver to do route, starting and ending at HQ
+    long double route_minutes(const std::vector<size_t>& route) const;
+
+    // Plans one driver's path into the last (empty) route of solution out of the loads marked in _available, returning its length (zero on
+    // trouble). Loads that make it into the path get unmarked.
+    size_t plan_path_for_driver(Probs& probs, Solution& solution);
+
+    // Cuts the last route of solution back to length loads, marking the loads it drops as available again. Returns length.
+    size_t finish_route(Solution& solution, size_t length);
 
     std::vector<std::string> _lines;
     std::ofstream* _log;
     long double _max_minutes;
 
     std::vector<Coordinate> _coordinates;
-    std::vector<std::vector<long double>> _distance_matrix;
+    DistanceMatrix _distance_matrix;
+    std::shared_ptr<const InstanceFile> _instance;  // keeps the mapping alive while _distance_matrix is attached to it
+
+    // plan_paths() scratch space, kept around so planning a candidate doesn't allocate
+    std::vector<uint8_t> _available;  // one per load id, nonzero while the load still needs a driver
+    std::vector<size_t> _reachable_loads;
 };
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+
+#include "evaluate_shared.h"
+#include "graph.h"
+#include "test_instances.h"
+
+namespace {
+
+const long double kMaxMinutes = 12 * 60;
+
+std::ofstream test_log;  // never opened, so logging goes nowhere
+
+// Every entry of the incrementally patched matrix should be what a full rebuild from the same coordinates gives
+void expect_matches_rebuild(const Graph& graph) {
+    Graph rebuilt({}, &test_log, kMaxMinutes);
+    rebuilt.reset(graph.getCoordinates());
+    const DistanceMatrix& patched = graph.getDistanceMatrix();
+    const DistanceMatrix& expected = rebuilt.getDistanceMatrix();
+    ASSERT_EQ(patched.size(), expected.size());
+    for (size_t from = 0; from < expected.size(); ++from) {
+        for (size_t to = 0; to < expected.size(); ++to) {
+            EXPECT_NEAR(patched[from][to], expected[from][to], 1e-9) << "from " << from << " to " << to;
+        }
+    }
+}
+
+// Each of loads 1 through num_coordinates - 1 exactly once, and every route doable in time
+void expect_valid_schedules(const Graph& graph, const std::vector<std::vector<size_t>>& schedules) {
+    std::vector<size_t> covered;
+    for (const auto& route : schedules) {
+        EXPECT_FALSE(route.empty());
+        EXPECT_LE(route_minutes(graph.getDistanceMatrix(), route), kMaxMinutes);
+        covered.insert(covered.end(), route.begin(), route.end());
+    }
+    std::sort(covered.begin(), covered.end());
+    std::vector<size_t> expected(graph.numCoordinates() - 1);
+    std::iota(expected.begin(), expected.end(), 1);
+    EXPECT_EQ(covered, expected);
+    EXPECT_EQ(EvaluateShared::validateSolutionSchedules(schedules, graph.numCoordinates()), 0);
+}
+
+}  // namespace
+
+TEST(GraphTests, AddLoadMatchesRebuild) {
+    std::vector<Coordinate> coordinates = random_coordinates(3, 12);
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(std::vector<Coordinate>(coordinates.begin(), coordinates.end() - 1));
+    EXPECT_EQ(graph.add_load(coordinates.back()), coordinates.size() - 1);
+    expect_matches_rebuild(graph);
+}
+
+TEST(GraphTests, AddLoadStartsFromNothing) {
+    // HQ gets added along with the first load
+    std::vector<Coordinate> coordinates = random_coordinates(4, 5);
+    Graph graph({}, &test_log, kMaxMinutes);
+    for (size_t load_id = 1; load_id < coordinates.size(); ++load_id) {
+        EXPECT_EQ(graph.add_load(coordinates[load_id]), load_id);
+    }
+    EXPECT_EQ(graph.numCoordinates(), coordinates.size());
+    expect_matches_rebuild(graph);
+}
+
+TEST(GraphTests, RemoveLoadRenumbersHighest) {
+    std::vector<Coordinate> coordinates = random_coordinates(5, 12);
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(coordinates);
+
+    // load 12 moves into slot 4
+    EXPECT_EQ(graph.remove_load(4), 12u);
+    ASSERT_EQ(graph.numCoordinates(), 12u);
+    EXPECT_EQ(graph.getCoordinates()[4].pickupX, coordinates[12].pickupX);
+    EXPECT_EQ(graph.getCoordinates()[4].dropOffY, coordinates[12].dropOffY);
+    expect_matches_rebuild(graph);
+
+    // the highest load just goes away
+    EXPECT_EQ(graph.remove_load(11), 11u);
+    EXPECT_EQ(graph.numCoordinates(), 11u);
+    expect_matches_rebuild(graph);
+
+    // HQ and loads that don't exist are left alone
+    EXPECT_EQ(graph.remove_load(0), 0u);
+    EXPECT_EQ(graph.remove_load(11), 11u);
+    EXPECT_EQ(graph.numCoordinates(), 11u);
+}
+
+TEST(GraphTests, RepairedSchedulesStayValid) {
+    // spread out enough that it takes several drivers
+    std::vector<Coordinate> coordinates = random_coordinates(6, 40, 125);
+    Graph graph({}, &test_log, kMaxMinutes);
+    std::vector<std::vector<size_t>> schedules;
+    for (size_t load_id = 1; load_id < coordinates.size(); ++load_id) {
+        EXPECT_EQ(graph.add_load_to_schedule(coordinates[load_id], schedules), load_id);
+        expect_valid_schedules(graph, schedules);
+    }
+    EXPECT_GT(schedules.size(), 1u);
+    expect_matches_rebuild(graph);
+
+    for (size_t load_id : {7, 1, 30, 37, 12}) {
+        graph.remove_load_from_schedule(load_id, schedules);
+        expect_valid_schedules(graph, schedules);
+    }
+    EXPECT_EQ(graph.numCoordinates(), 36u);
+    expect_matches_rebuild(graph);
+
+    // removing the highest load doesn't renumber anything
+    graph.remove_load_from_schedule(graph.numCoordinates() - 1, schedules);
+    expect_valid_schedules(graph, schedules);
+}
+
+TEST(GraphTests, AddLoadGrowsStrideModestly) {
+    // the first add after a full build has to reallocate, but shouldn't be anywhere near a (2n)^2 buffer
+    std::vector<Coordinate> coordinates = random_coordinates(7, 400);
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(std::vector<Coordinate>(coordinates.begin(), coordinates.end() - 1));
+    EXPECT_EQ(graph.getDistanceMatrix().stride(), 400u);
+    graph.add_load(coordinates.back());
+    EXPECT_EQ(graph.getDistanceMatrix().stride(), 400u + 400u / 8);
+
+    // and the next few fit in the padding without moving anything
+    const double* data = graph.getDistanceMatrix()[0];
+    for (size_t ii = 0; ii < 10; ++ii) {
+        graph.add_load(coordinates[1 + ii]);
+    }
+    EXPECT_EQ(graph.getDistanceMatrix()[0], data);
+    expect_matches_rebuild(graph);
+}
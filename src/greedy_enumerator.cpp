@@ -0,0 +1,209 @@
+#include "greedy_enumerator.h"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+#include "masked_argmin.h"
+
+GreedyEnumerator::GreedyEnumerator(const DistanceMatrix* distance_matrix, long double max_minutes, std::ofstream* log, size_t max_starts)
+: _distance_matrix(distance_matrix)
+, _max_minutes(max_minutes)
+, _log(log)
+, _max_starts(std::max<size_t>(1, max_starts))
+, _pool(nullptr)
+, _deadline(std::chrono::steady_clock::time_point::max())
+, _scratch(1)
+, _memo_hits(0) {
+    // Fixed seed, these only need to look random to each other
+    std::mt19937_64 gen(0x5EED);
+    _zobrist.resize(_distance_matrix->size());
+    for (uint64_t& key : _zobrist) {
+        key = gen();
+    }
+}
+
+void GreedyEnumerator::set_thread_pool(ThreadPool* pool) {
+    _pool = pool;
+    _scratch.resize(pool ? std::max<size_t>(1, pool->size()) : 1);
+}
+
+double GreedyEnumerator::walk_route(Scheme scheme, uint32_t first_load, std::vector<uint8_t>& available, std::vector<uint32_t>& route) const {
+    // Same rules as Graph::plan_path_for_driver for these schemes (minus returning to HQ early, which they never do)
+    const DistanceMatrix& matrix = *_distance_matrix;
+    const double* hq_distances = matrix[0];
+    route.clear();
+    if (!(hq_distances[first_load] < _max_minutes)) {
+        return -1;
+    }
+    route.push_back(first_load);
+    available[first_load] = 0;
+    long double cumulative_minutes = hq_distances[first_load];
+    size_t current_load = first_load;
+    size_t fallback_length = 0;
+    long double fallback_minutes = 0;
+
+    while (cumulative_minutes < _max_minutes) {
+        const double* current_distances = matrix[current_load];
+        if (cumulative_minutes + current_distances[0] < _max_minutes) {
+            fallback_length = route.size();
+            fallback_minutes = cumulative_minutes + current_distances[0];
+        }
+        double budget = static_cast<double>(_max_minutes - cumulative_minutes);
+        size_t next_load = 0;
+        if (scheme == Scheme::OnwayNearest) {
+            next_load = masked_argmin(current_distances, hq_distances, available.data(), available.size(), budget);
+        }
+        if (next_load == 0) {
+            next_load = masked_argmin(current_distances, nullptr, available.data(), available.size(), budget);
+        }
+        if (next_load == 0) {
+            break;
+        }
+        route.push_back(static_cast<uint32_t>(next_load));
+        available[next_load] = 0;
+        cumulative_minutes += current_distances[next_load];
+        current_load = next_load;
+    }
+
+    // anything past the fallback goes back up for grabs
+    for (size_t position = fallback_length; position < route.size(); ++position) {
+        available[route[position]] = 1;
+    }
+    route.resize(fallback_length);
+    return route.empty() ? -1 : static_cast<double>(fallback_minutes);
+}
+
+double GreedyEnumerator::follow(Scheme scheme, uint32_t start, Scratch& scratch) {
+    const double kInfinity = std::numeric_limits<double>::infinity();
+    size_t num_coordinates = _distance_matrix->size();
+    scratch.available.assign(num_coordinates, 1);
+    scratch.available[0] = 0;
+    uint64_t remaining_hash = 0;
+    for (size_t load_id = 1; load_id < num_coordinates; ++load_id) {
+        remaining_hash ^= _zobrist[load_id];
+    }
+    size_t remaining_loads = num_coordinates - 1;
+
+    // Walk routes until we either run out of loads or land on a state some earlier walk already finished
+    scratch.pending.clear();
+    StateKey key{remaining_hash, start};
+    double tail_cost = 0;
+    bool ends_in_memo = false;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(_memo_mutex);
+            auto it = _memo.find(key);
+            if (it != _memo.end()) {
+                tail_cost = it->second.cost_to_go;
+                ends_in_memo = true;
+                ++_memo_hits;
+                break;
+            }
+        }
+
+        scratch.pending.emplace_back();
+        PendingRoute& pending = scratch.pending.back();
+        pending.key = key;
+        pending.minutes = walk_route(scheme, key.first_load, scratch.available, pending.route);
+        if (pending.minutes < 0) {
+            // a load nobody can do in time, shouldn't happen for a valid problem
+            return kInfinity;
+        }
+        for (uint32_t load_id : pending.route) {
+            key.remaining_hash ^= _zobrist[load_id];
+        }
+        remaining_loads -= pending.route.size();
+        if (remaining_loads == 0) {
+            break;
+        }
+        // The next driver starts at whatever's left that's nearest HQ (not at random like hqGoesToRandom,
+        // see the class comment)
+        key.first_load = static_cast<uint32_t>(masked_argmin((*_distance_matrix)[0], nullptr, scratch.available.data(), num_coordinates, static_cast<double>(_max_minutes)));
+        if (key.first_load == 0) {
+            return kInfinity;
+        }
+    }
+
+    // Fill in the memo from the back, now that the cost after each route is known
+    std::lock_guard<std::mutex> lock(_memo_mutex);
+    for (size_t index = scratch.pending.size(); index-- > 0;) {
+        PendingRoute& pending = scratch.pending[index];
+        tail_cost += 500 + pending.minutes;
+        if (_memo.size() >= kMaxMemoEntries) {
+            continue;
+        }
+        MemoEntry entry;
+        entry.route.swap(pending.route);
+        entry.cost_to_go = tail_cost;
+        entry.has_next = (index + 1 < scratch.pending.size()) || ends_in_memo;
+        entry.next = (index + 1 < scratch.pending.size()) ? scratch.pending[index + 1].key : key;
+        _memo.emplace(pending.key, std::move(entry));
+    }
+    return tail_cost;
+}
+
+bool GreedyEnumerator::solve(Scheme scheme, Solution& solution) {
+    size_t num_loads = _distance_matrix->empty() ? 0 : _distance_matrix->size() - 1;
+    if (num_loads == 0) {
+        return false;
+    }
+    _memo.clear();
+    _memo_hits = 0;
+
+    size_t stride = (num_loads + _max_starts - 1) / _max_starts;
+    size_t num_starts = (num_loads + stride - 1) / stride;
+    std::vector<double> costs(num_starts, std::numeric_limits<double>::infinity());
+    auto follow_start = [&](size_t worker_index, size_t start_index) {
+        if (std::chrono::steady_clock::now() >= _deadline) {
+            return;
+        }
+        costs[start_index] = follow(scheme, static_cast<uint32_t>(1 + start_index * stride), _scratch[worker_index]);
+    };
+    if (_pool && num_starts > 1) {
+        _pool->run_all(num_starts, follow_start);
+    } else {
+        for (size_t start_index = 0; start_index < num_starts; ++start_index) {
+            follow_start(0, start_index);
+        }
+    }
+
+    size_t best_start = std::min_element(costs.begin(), costs.end()) - costs.begin();
+    if (costs[best_start] == std::numeric_limits<double>::infinity()) {
+        return false;
+    }
+
+#if LOGGING
+    *_log << "Enumerated " << num_starts << " starts for scheme " << static_cast<int>(scheme) << ", memo hits = " << _memo_hits
+          << ", memo size = " << _memo.size() << ", best cost = " << costs[best_start] << std::endl;
+#endif
+
+    // Rebuild the best start's solution by following memo links. The memo can only be missing states if it
+    // filled up, in which case walking that start again (on its own) puts them back.
+    uint64_t full_hash = 0;
+    for (size_t load_id = 1; load_id <= num_loads; ++load_id) {
+        full_hash ^= _zobrist[load_id];
+    }
+    StateKey key{full_hash, static_cast<uint32_t>(1 + best_start * stride)};
+    if (_memo.size() >= kMaxMemoEntries) {
+        _memo.clear();
+        follow(scheme, key.first_load, _scratch[0]);
+    }
+    solution.clear();
+    while (true) {
+        auto it = _memo.find(key);
+        if (it == _memo.end()) {
+            solution.clear();
+            return false;
+        }
+        solution.begin_route();
+        for (uint32_t load_id : it->second.route) {
+            solution.push_load(load_id);
+        }
+        if (!it->second.has_next) {
+            break;
+        }
+        key = it->second.next;
+    }
+    return true;
+}
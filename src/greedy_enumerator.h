@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "distance_matrix.h"
+#include "scheme.h"
+#include "solution.h"
+#include "thread_pool.h"
+
+// Deterministic GreedyNearest / OnwayNearest walks from every first load (or every stride-th one, for huge
+// instances), as opposed to the random starts Probs(0,1,0,0,0,true) and Probs(0,0,1,0,0,true) sample.
+//
+// The rule for later drivers is different from those Probs though. With hqGoesToRandom every driver leaving
+// HQ goes to a random load, whereas here only the first driver's start varies: the route follows the scheme
+// until nothing more is reachable (cut back to the last point it could still get home in time), and every
+// later driver starts at the remaining load nearest HQ. That's what makes it deterministic, so it doesn't
+// replace the random-per-driver sampling (the Solver still does some of that too).
+//
+// The upside of the fixed rule is that the rest of a solution only depends on (first load of the next route,
+// set of loads remaining), and lots of starts end up passing through the same states. Those are memoised,
+// keyed by the first load plus a Zobrist hash of the remaining set, so each shared suffix of routes only gets
+// walked once.
+class GreedyEnumerator {
+public:
+    static constexpr size_t kDefaultMaxStarts = 2000;
+
+    // Memo entries hold one route each, past this many new states just don't get remembered
+    static constexpr size_t kMaxMemoEntries = 1 << 20;
+
+    GreedyEnumerator(const DistanceMatrix* distance_matrix, long double max_minutes, std::ofstream* log,
+                     size_t max_starts = kDefaultMaxStarts);
+
+    // Starts get walked in parallel on pool, which mustn't be the pool running the caller (see
+    // ThreadPool::run_all). nullptr (the default) walks them one after another.
+    void set_thread_pool(ThreadPool* pool);
+
+    // Starts not yet walked once this passes are skipped
+    void set_deadline(std::chrono::steady_clock::time_point deadline) {
+        _deadline = deadline;
+    }
+
+    // Walks scheme (GreedyNearest or OnwayNearest) from every start, building the cheapest result into
+    // solution. Returns false (leaving solution alone) if no start produced a complete solution.
+    bool solve(Scheme scheme, Solution& solution);
+
+    size_t memo_hits() const {
+        return _memo_hits;
+    }
+
+    size_t memo_size() const {
+        return _memo.size();
+    }
+
+private:
+    struct StateKey {
+        uint64_t remaining_hash;
+        uint32_t first_load;
+
+        bool operator==(const StateKey& other) const {
+            return remaining_hash == other.remaining_hash && first_load == other.first_load;
+        }
+    };
+
+    struct StateKeyHash {
+        size_t operator()(const StateKey& key) const {
+            return static_cast<size_t>(key.remaining_hash ^ (uint64_t(key.first_load) * 0x9E3779B97F4A7C15ull));
+        }
+    };
+
+    // The route starting at a state, and where the solution goes after it
+    struct MemoEntry {
+        std::vector<uint32_t> route;
+        double cost_to_go;  // 500 per driver plus minutes, for this route and everything after it
+        bool has_next;
+        StateKey next;
+    };
+
+    // A route walked but not yet in the memo, while a start is being followed
+    struct PendingRoute {
+        StateKey key;
+        std::vector<uint32_t> route;
+        double minutes;
+    };
+
+    struct Scratch {
+        std::vector<uint8_t> available;
+        std::vector<PendingRoute> pending;
+    };
+
+    const DistanceMatrix* _distance_matrix;
+    long double _max_minutes;
+    std::ofstream* _log;
+    size_t _max_starts;
+    ThreadPool* _pool;
+    std::chrono::steady_clock::time_point _deadline;
+
+    std::vector<uint64_t> _zobrist;  // random key per load id, XORed together to hash a set of loads
+    std::vector<Scratch> _scratch;   // one per worker
+
+    std::mutex _memo_mutex;
+    std::unordered_map<StateKey, MemoEntry, StateKeyHash> _memo;
+    std::atomic<size_t> _memo_hits;
+
+    // Follows start all the way through, filling in the memo. Returns its cost, or infinity on trouble.
+    double follow(Scheme scheme, uint32_t start, Scratch& scratch);
+
+    // Walks one driver's route from first_load over the loads marked in available (unmarking the ones it
+    // keeps), returning its minutes, or a negative number if first_load can't be done at all
+    double walk_route(Scheme scheme, uint32_t first_load, std::vector<uint8_t>& available, std::vector<uint32_t>& route) const;
+};
@@ -0,0 +1,188 @@
+#include "instance_file.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kMagic[8] = {'V', 'R', 'P', 'I', 'N', 'S', 'T', '\0'};
+const uint32_t kHasMatrix = 1;
+const size_t kAlignment = 64;
+const uint64_t kChecksumBasis = 14695981039346656037ull;
+
+size_t align_up(size_t offset) {
+    return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+}  // namespace
+
+InstanceFile::~InstanceFile() {
+    ::munmap(_mapping, _length);
+}
+
+uint64_t InstanceFile::checksum(const void* data, size_t length, uint64_t hash) {
+    // FNV-1a, but a 64 bit word at a time rather than a byte at a time so it keeps up with big matrices. Every
+    // section is made of doubles, so length is always a multiple of 8 (which also means checksumming a section
+    // in pieces, feeding each hash into the next, gives the same answer as all at once).
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t offset = 0; offset + sizeof(uint64_t) <= length; offset += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes + offset, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool InstanceFile::is_instance_file(const std::string& path) {
+    std::ifstream infile(path, std::ios::binary);
+    char magic[sizeof(kMagic)];
+    if (!infile.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+int InstanceFile::write(const std::string& path, const std::vector<Coordinate>& coordinates, const DistanceMatrix* distance_matrix) {
+    size_t num_coordinates = coordinates.size();
+    if (distance_matrix && distance_matrix->size() != num_coordinates) {
+        return 1;
+    }
+
+    std::vector<double> flat_coordinates;
+    flat_coordinates.reserve(4 * num_coordinates);
+    for (const auto& coord : coordinates) {
+        flat_coordinates.push_back(static_cast<double>(coord.pickupX));
+        flat_coordinates.push_back(static_cast<double>(coord.pickupY));
+        flat_coordinates.push_back(static_cast<double>(coord.dropOffX));
+        flat_coordinates.push_back(static_cast<double>(coord.dropOffY));
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.num_coordinates = num_coordinates;
+    header.coordinates_offset = align_up(sizeof(Header));
+    header.coordinates_checksum = checksum(flat_coordinates.data(), flat_coordinates.size() * sizeof(double), kChecksumBasis);
+
+    // DistanceMatrix rows can be padded out, so checksum (and write) it row by row
+    size_t matrix_row_bytes = num_coordinates * sizeof(double);
+    if (distance_matrix) {
+        header.flags |= kHasMatrix;
+        header.matrix_offset = align_up(header.coordinates_offset + flat_coordinates.size() * sizeof(double));
+        header.matrix_checksum = kChecksumBasis;
+        for (size_t from = 0; from < num_coordinates; ++from) {
+            header.matrix_checksum = checksum((*distance_matrix)[from], matrix_row_bytes, header.matrix_checksum);
+        }
+    }
+
+    std::ofstream outfile(path, std::ios::binary | std::ios::trunc);
+    if (!outfile) {
+        return 1;
+    }
+    std::vector<char> padding(kAlignment, 0);
+    outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outfile.write(padding.data(), header.coordinates_offset - sizeof(header));
+    outfile.write(reinterpret_cast<const char*>(flat_coordinates.data()), flat_coordinates.size() * sizeof(double));
+    if (distance_matrix) {
+        outfile.write(padding.data(), header.matrix_offset - header.coordinates_offset - flat_coordinates.size() * sizeof(double));
+        for (size_t from = 0; from < num_coordinates; ++from) {
+            outfile.write(reinterpret_cast<const char*>((*distance_matrix)[from]), matrix_row_bytes);
+        }
+    }
+    return outfile.good() ? 0 : 1;
+}
+
+std::shared_ptr<InstanceFile> InstanceFile::open(const std::string& path, bool verify_matrix_checksum, std::string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "unable to open " + path + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+        ::close(fd);
+        error = path + " is too small to be an instance file";
+        return nullptr;
+    }
+    size_t length = static_cast<size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = "unable to map " + path + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    std::shared_ptr<InstanceFile> instance(new InstanceFile(mapping, length));
+    const Header& header = *instance->_header;
+    const char* base = static_cast<const char*>(mapping);
+
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        error = path + " is not an instance file";
+        return nullptr;
+    }
+    if (header.version != kVersion) {
+        error = path + " has unsupported version " + std::to_string(header.version);
+        return nullptr;
+    }
+
+    // Header fields can't be trusted yet, so every size check is written so it can't overflow (subtracting from
+    // length, which is known to be in range, rather than adding offsets together)
+    if (header.num_coordinates > length / (4 * sizeof(double))) {
+        error = path + " is truncated";
+        return nullptr;
+    }
+    size_t coordinates_bytes = header.num_coordinates * 4 * sizeof(double);
+    if (header.coordinates_offset % kAlignment != 0 || header.coordinates_offset > length || coordinates_bytes > length - header.coordinates_offset) {
+        error = path + " is truncated";
+        return nullptr;
+    }
+    if (checksum(base + header.coordinates_offset, coordinates_bytes, kChecksumBasis) != header.coordinates_checksum) {
+        error = path + " has a bad coordinates checksum";
+        return nullptr;
+    }
+
+    if (header.flags & kHasMatrix) {
+        // num_coordinates squared doubles has to fit in a size_t, ie num_coordinates <= sqrt(SIZE_MAX / 8)
+        if (header.num_coordinates > 0 && header.num_coordinates > SIZE_MAX / sizeof(double) / header.num_coordinates) {
+            error = path + " is truncated";
+            return nullptr;
+        }
+        size_t matrix_bytes = header.num_coordinates * header.num_coordinates * sizeof(double);
+        if (header.matrix_offset % kAlignment != 0 || header.matrix_offset > length || matrix_bytes > length - header.matrix_offset) {
+            error = path + " is truncated";
+            return nullptr;
+        }
+        if (verify_matrix_checksum && checksum(base + header.matrix_offset, matrix_bytes, kChecksumBasis) != header.matrix_checksum) {
+            error = path + " has a bad matrix checksum";
+            return nullptr;
+        }
+    }
+    return instance;
+}
+
+std::vector<Coordinate> InstanceFile::getCoordinates() const {
+    const double* flat = reinterpret_cast<const double*>(static_cast<const char*>(_mapping) + _header->coordinates_offset);
+    std::vector<Coordinate> coordinates(_header->num_coordinates);
+    for (size_t ii = 0; ii < coordinates.size(); ++ii) {
+        coordinates[ii].pickupX = flat[4 * ii];
+        coordinates[ii].pickupY = flat[4 * ii + 1];
+        coordinates[ii].dropOffX = flat[4 * ii + 2];
+        coordinates[ii].dropOffY = flat[4 * ii + 3];
+    }
+    return coordinates;
+}
+
+const double* InstanceFile::getDistanceMatrix() const {
+    if (!(_header->flags & kHasMatrix)) {
+        return nullptr;
+    }
+    return reinterpret_cast<const double*>(static_cast<const char*>(_mapping) + _header->matrix_offset);
+}
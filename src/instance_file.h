@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "coordinate.h"
+#include "distance_matrix.h"
+
+// Compact binary version of a problem, so re-solving the same instance skips parsing text and (optionally)
+// rebuilding the O(n^2) distance matrix. Files are memory mapped read-only, so a Graph can use the matrix in
+// place, and concurrent processes solving the same file share it through the page cache.
+//
+// Layout (native endianness, every section 64 byte aligned):
+//
+//   header         see InstanceFile::Header
+//   coordinates    num_coordinates x {pickupX, pickupY, dropOffX, dropOffY} as doubles, HQ first
+//   matrix         optional, num_coordinates x num_coordinates doubles, row major, same as DistanceMatrix
+//
+// Each section has its own checksum. The coordinates checksum is always verified when opening, the matrix one
+// only on request, since that means reading the whole matrix in.
+class InstanceFile {
+public:
+    static constexpr uint32_t kVersion = 1;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t flags;
+        uint64_t num_coordinates;
+        uint64_t coordinates_offset;
+        uint64_t matrix_offset;   // zero if there's no matrix
+        uint64_t coordinates_checksum;
+        uint64_t matrix_checksum;
+        uint64_t reserved;
+    };
+
+    ~InstanceFile();
+
+    InstanceFile(const InstanceFile&) = delete;
+    InstanceFile& operator=(const InstanceFile&) = delete;
+
+    // Whether path starts with the instance file magic (as opposed to being a text problem)
+    static bool is_instance_file(const std::string& path);
+
+    // Writes coordinates (HQ first), plus distance_matrix unless it's null. Returns nonzero on trouble.
+    static int write(const std::string& path, const std::vector<Coordinate>& coordinates, const DistanceMatrix* distance_matrix);
+
+    // Maps path into memory, returning null (with the reason in error) if it can't be opened or fails validation
+    static std::shared_ptr<InstanceFile> open(const std::string& path, bool verify_matrix_checksum, std::string& error);
+
+    size_t numCoordinates() const {
+        return _header->num_coordinates;
+    }
+
+    std::vector<Coordinate> getCoordinates() const;
+
+    // Points into the mapping, null if the file has no matrix
+    const double* getDistanceMatrix() const;
+
+private:
+    InstanceFile(void* mapping, size_t length)
+    : _mapping(mapping)
+    , _length(length)
+    , _header(static_cast<const Header*>(mapping)) {}
+
+    void* _mapping;
+    size_t _length;
+    const Header* _header;
+
+    static uint64_t checksum(const void* data, size_t length, uint64_t hash);
+};
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "graph.h"
+#include "instance_file.h"
+#include "test_instances.h"
+
+namespace {
+
+const long double kMaxMinutes = 12 * 60;
+
+std::ofstream test_log;  // never opened, so logging goes nowhere
+
+std::string temp_path(const std::string& name) {
+    return testing::TempDir() + "vehicle_routing_" + name;
+}
+
+std::string read_bytes(const std::string& path) {
+    std::ifstream infile(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(infile), std::istreambuf_iterator<char>());
+}
+
+void write_bytes(const std::string& path, const std::string& bytes) {
+    std::ofstream outfile(path, std::ios::binary | std::ios::trunc);
+    outfile.write(bytes.data(), bytes.size());
+}
+
+// Overwrites the header field at offset (see InstanceFile::Header) with value
+template <typename T>
+void patch(std::string& bytes, size_t offset, T value) {
+    std::memcpy(&bytes[offset], &value, sizeof(value));
+}
+
+// Writes a small instance (with its matrix unless with_matrix is false) to path, returning its bytes
+std::string write_instance(const std::string& path, bool with_matrix = true) {
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(21, 25));
+    EXPECT_EQ(InstanceFile::write(path, graph.getCoordinates(), with_matrix ? &graph.getDistanceMatrix() : nullptr), 0);
+    return read_bytes(path);
+}
+
+// open() has to fail, with message somewhere in the error
+void expect_rejected(const std::string& path, bool verify_matrix_checksum, const std::string& message) {
+    std::string error;
+    EXPECT_EQ(InstanceFile::open(path, verify_matrix_checksum, error), nullptr);
+    EXPECT_NE(error.find(message), std::string::npos) << error;
+}
+
+}  // namespace
+
+TEST(InstanceFileTests, RoundTrip) {
+    std::string path = temp_path("round_trip.bin");
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(22, 30));
+    ASSERT_EQ(InstanceFile::write(path, graph.getCoordinates(), &graph.getDistanceMatrix()), 0);
+    EXPECT_TRUE(InstanceFile::is_instance_file(path));
+
+    std::string error;
+    auto instance = InstanceFile::open(path, true, error);
+    ASSERT_NE(instance, nullptr) << error;
+    ASSERT_EQ(instance->numCoordinates(), graph.numCoordinates());
+    std::vector<Coordinate> coordinates = instance->getCoordinates();
+    for (size_t ii = 0; ii < coordinates.size(); ++ii) {
+        EXPECT_EQ(coordinates[ii].pickupX, graph.getCoordinates()[ii].pickupX);
+        EXPECT_EQ(coordinates[ii].pickupY, graph.getCoordinates()[ii].pickupY);
+        EXPECT_EQ(coordinates[ii].dropOffX, graph.getCoordinates()[ii].dropOffX);
+        EXPECT_EQ(coordinates[ii].dropOffY, graph.getCoordinates()[ii].dropOffY);
+    }
+    const double* matrix = instance->getDistanceMatrix();
+    ASSERT_NE(matrix, nullptr);
+    size_t n = graph.numCoordinates();
+    for (size_t from = 0; from < n; ++from) {
+        for (size_t to = 0; to < n; ++to) {
+            EXPECT_EQ(matrix[from * n + to], graph.getDistanceMatrix()[from][to]);
+        }
+    }
+
+    // and a Graph loading it uses the same matrix
+    Graph loaded({}, &test_log, kMaxMinutes);
+    ASSERT_EQ(loaded.load(path, error, true), 0) << error;
+    ASSERT_EQ(loaded.getDistanceMatrix().size(), n);
+    EXPECT_EQ(loaded.getDistanceMatrix()[n - 1][1], graph.getDistanceMatrix()[n - 1][1]);
+}
+
+TEST(InstanceFileTests, RoundTripWithoutMatrix) {
+    std::string path = temp_path("no_matrix.bin");
+    write_instance(path, false);
+    std::string error;
+    auto instance = InstanceFile::open(path, true, error);
+    ASSERT_NE(instance, nullptr) << error;
+    EXPECT_EQ(instance->numCoordinates(), 26u);
+    EXPECT_EQ(instance->getDistanceMatrix(), nullptr);
+
+    // the matrix gets rebuilt from the coordinates instead
+    Graph loaded({}, &test_log, kMaxMinutes);
+    ASSERT_EQ(loaded.load(path, error), 0) << error;
+    EXPECT_EQ(loaded.getDistanceMatrix().size(), 26u);
+}
+
+TEST(InstanceFileTests, RejectsTruncated) {
+    std::string path = temp_path("truncated.bin");
+    std::string bytes = write_instance(path);
+
+    // cut off partway through the matrix, then partway through the coordinates
+    write_bytes(path, bytes.substr(0, bytes.size() - 8));
+    expect_rejected(path, false, "is truncated");
+    write_bytes(path, bytes.substr(0, sizeof(InstanceFile::Header) + 64));
+    expect_rejected(path, false, "is truncated");
+
+    // not even a whole header
+    write_bytes(path, bytes.substr(0, sizeof(InstanceFile::Header) - 1));
+    expect_rejected(path, false, "too small");
+    EXPECT_FALSE(InstanceFile::is_instance_file(temp_path("does_not_exist.bin")));
+}
+
+TEST(InstanceFileTests, RejectsBadMagicAndVersion) {
+    std::string path = temp_path("bad_header.bin");
+    std::string bytes = write_instance(path);
+
+    std::string bad_magic = bytes;
+    bad_magic[0] = 'X';
+    write_bytes(path, bad_magic);
+    EXPECT_FALSE(InstanceFile::is_instance_file(path));
+    expect_rejected(path, false, "is not an instance file");
+
+    std::string bad_version = bytes;
+    patch<uint32_t>(bad_version, offsetof(InstanceFile::Header, version), InstanceFile::kVersion + 1);
+    write_bytes(path, bad_version);
+    expect_rejected(path, false, "unsupported version");
+}
+
+TEST(InstanceFileTests, RejectsBadChecksums) {
+    std::string path = temp_path("bad_checksum.bin");
+    std::string bytes = write_instance(path);
+    InstanceFile::Header header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+
+    // coordinates are always checked
+    std::string bad_coordinates = bytes;
+    bad_coordinates[header.coordinates_offset + 8] ^= 1;
+    write_bytes(path, bad_coordinates);
+    expect_rejected(path, false, "bad coordinates checksum");
+    expect_rejected(path, true, "bad coordinates checksum");
+
+    // the matrix only when asked to
+    std::string bad_matrix = bytes;
+    bad_matrix[header.matrix_offset + 8 * 27 + 3] ^= 1;
+    write_bytes(path, bad_matrix);
+    std::string error;
+    EXPECT_NE(InstanceFile::open(path, false, error), nullptr) << error;
+    expect_rejected(path, true, "bad matrix checksum");
+}
+
+TEST(InstanceFileTests, RejectsOverflowingHeader) {
+    std::string path = temp_path("overflow.bin");
+    std::string bytes = write_instance(path);
+
+    // counts and offsets far past the end of the file (or wrapping around when added up) are caught
+    // before anything gets read
+    for (uint64_t num_coordinates : {uint64_t(1) << 40, uint64_t(1) << 61, UINT64_MAX}) {
+        std::string bad = bytes;
+        patch<uint64_t>(bad, offsetof(InstanceFile::Header, num_coordinates), num_coordinates);
+        write_bytes(path, bad);
+        expect_rejected(path, true, "is truncated");
+    }
+    for (size_t field : {offsetof(InstanceFile::Header, coordinates_offset), offsetof(InstanceFile::Header, matrix_offset)}) {
+        for (uint64_t offset : {uint64_t(bytes.size()) & ~uint64_t(63), UINT64_MAX & ~uint64_t(63)}) {
+            std::string bad = bytes;
+            patch<uint64_t>(bad, field, offset);
+            write_bytes(path, bad);
+            expect_rejected(path, true, "is truncated");
+        }
+    }
+}
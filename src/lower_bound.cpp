@@ -0,0 +1,265 @@
+#include "lower_bound.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Large enough to never get picked in an assignment, small enough to not overflow when potentials are added up
+const double kForbidden = 1e12;
+
+// Bounds are computed in floating point, so knock a hair off to make sure rounding never makes them too high
+const long double kSafety = 1e-6L;
+
+// Guess at how long an n x n assignment takes, n^3 times this, until one has actually been timed. On the high
+// side, guessing low is what costs the search its time.
+const double kSecondsPerCubedLoad = 3e-9;
+
+}  // namespace
+
+void LowerBound::compute() {
+    const auto& matrix = *_distance_matrix;
+    size_t num_loads = matrix.empty() ? 0 : matrix.size() - 1;
+    if (num_loads == 0) {
+        _min_drivers = 0;
+        _bound = 0;
+        return;
+    }
+
+    // Cheapest way into each load (from HQ or any other load), and the cheapest way back to HQ from any load
+    long double incoming_sum = 0;
+    long double cheapest_return = std::numeric_limits<long double>::infinity();
+    for (size_t to_load = 1; to_load <= num_loads; ++to_load) {
+        long double cheapest_in = std::numeric_limits<long double>::infinity();
+        for (size_t from_load = 0; from_load <= num_loads; ++from_load) {
+            if (from_load != to_load) {
+                cheapest_in = std::min<long double>(cheapest_in, matrix[from_load][to_load]);
+            }
+        }
+        incoming_sum += cheapest_in;
+        cheapest_return = std::min<long double>(cheapest_return, matrix[to_load][0]);
+    }
+
+    // k drivers need k * max_minutes >= incoming_sum + k * cheapest_return
+    _min_drivers = 1;
+    if (cheapest_return < _max_minutes) {
+        _min_drivers = std::max<size_t>(1, static_cast<size_t>(std::ceil(incoming_sum / (_max_minutes - cheapest_return) - kSafety)));
+    }
+    _min_drivers = std::min(_min_drivers, num_loads);
+    long double simple_bound = 500.L * _min_drivers + incoming_sum + _min_drivers * cheapest_return;
+    _bound = simple_bound;
+
+#if LOGGING
+    *_log << "LowerBound: min drivers = " << _min_drivers << ", simple bound = " << simple_bound << std::endl;
+#endif
+
+    if (num_loads > kMaxAssignmentLoads) {
+        _bound -= kSafety * _bound;
+        return;
+    }
+
+    // With a deadline, the relaxations below only get to run while they fit in our share of the time left.
+    // The full relaxation is twice the size, so it takes 8 times as long as a compact one.
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    Clock::time_point give_up = Clock::time_point::max();
+    if (_deadline != Clock::time_point::max()) {
+        give_up = start + std::chrono::duration_cast<Clock::duration>((std::max(_deadline, start) - start) * kMaxDeadlineShare);
+    }
+    double compact_seconds = kSecondsPerCubedLoad * num_loads * num_loads * num_loads;
+    auto fits = [&](double seconds) {
+        return give_up == Clock::time_point::max() || Clock::now() + std::chrono::duration<double>(seconds) <= give_up;
+    };
+    if (!fits(compact_seconds)) {
+#if LOGGING
+        *_log << "LowerBound: no time for the relaxations" << std::endl;
+#endif
+        _bound -= kSafety * _bound;
+        return;
+    }
+
+    // With drivers free, the relaxation is a bound on minutes alone, and so on the number of drivers needed
+    double min_minutes = compact_relaxation(0., 1.);
+    compact_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    size_t assignment_drivers = static_cast<size_t>(std::ceil(min_minutes / _max_minutes - kSafety));
+    if (assignment_drivers > _min_drivers) {
+        _min_drivers = std::min(assignment_drivers, num_loads);
+        simple_bound = std::max(simple_bound, 500.L * _min_drivers + min_minutes);
+    }
+#if LOGGING
+    *_log << "LowerBound: min drivers from minutes = " << assignment_drivers << std::endl;
+#endif
+
+    // The assignment relaxation knows nothing about max_minutes, so it happily covers everything with far
+    // too few drivers. Every real solution has minutes <= max_minutes * drivers though, so for any multiplier
+    // m >= 0 its cost is at least 500 * drivers + minutes + m * (minutes - max_minutes * drivers), ie a driver
+    // costing 500 - m * max_minutes and minutes weighted 1 + m. Relaxing that instead is a valid bound for
+    // every m, and the best m is found by golden section search (the bound is concave in m).
+    const double kGolden = 0.6180339887498949;
+    double low = 0;
+    double high = kMaxMultiplier;
+    long double lagrangian = 0;
+    if (fits(2 * compact_seconds)) {
+        double left = high - kGolden * (high - low);
+        double right = low + kGolden * (high - low);
+        long double left_bound = lagrangian_bound(left);
+        long double right_bound = lagrangian_bound(right);
+        lagrangian = std::max(left_bound, right_bound);
+        for (size_t step = 2; step < kMultiplierSteps && fits(compact_seconds); ++step) {
+            if (left_bound < right_bound) {
+                low = left;
+                left = right;
+                left_bound = right_bound;
+                right = low + kGolden * (high - low);
+                right_bound = lagrangian_bound(right);
+                lagrangian = std::max(lagrangian, right_bound);
+            } else {
+                high = right;
+                right = left;
+                right_bound = left_bound;
+                left = high - kGolden * (high - low);
+                left_bound = lagrangian_bound(left);
+                lagrangian = std::max(lagrangian, left_bound);
+            }
+        }
+    }
+#if LOGGING
+    *_log << "LowerBound: lagrangian bound = " << lagrangian << " (multiplier near " << (low + high) / 2 << ")" << std::endl;
+#endif
+
+    // Usually no better than the Lagrangian bound, and the most expensive by far, so it goes last
+    long double assignment_bound = 0;
+    if (fits(8 * compact_seconds)) {
+        assignment_bound = relaxation(500., 1.);
+    }
+#if LOGGING
+    *_log << "LowerBound: assignment bound = " << assignment_bound << std::endl;
+#endif
+
+    _bound = std::max({simple_bound, assignment_bound, lagrangian});
+    _bound -= kSafety * _bound;
+}
+
+long double LowerBound::lagrangian_bound(double multiplier) const {
+    return compact_relaxation(500. - multiplier * static_cast<double>(_max_minutes), 1. + multiplier);
+}
+
+double LowerBound::compact_relaxation(double driver_cost, double minute_weight) const {
+    const auto& matrix = *_distance_matrix;
+    size_t num_loads = matrix.size() - 1;
+
+    // Lay a solution's routes out in a cycle and every load has a successor: the next load on its route, or
+    // else (via HQ, hiring a driver) the first load of the next route. So without HQ copies, each load just
+    // picks the cheaper of going straight to its successor or going via HQ.
+    std::vector<double> cost(num_loads * num_loads);
+    for (size_t from = 1; from <= num_loads; ++from) {
+        const double* from_row = matrix[from];
+        double* cost_row = &cost[(from - 1) * num_loads];
+        for (size_t to = 1; to <= num_loads; ++to) {
+            double via_hq = driver_cost + minute_weight * (from_row[0] + matrix[0][to]);
+            cost_row[to - 1] = (from == to) ? via_hq : std::min(via_hq, minute_weight * from_row[to]);
+        }
+    }
+    return solve_assignment(cost, num_loads);
+}
+
+double LowerBound::relaxation(double driver_cost, double minute_weight) const {
+    const auto& matrix = *_distance_matrix;
+    size_t num_loads = matrix.size() - 1;
+
+    // Rows/columns 0..num_loads-1 are loads 1..num_loads, the rest are HQ copies (one per possible driver)
+    size_t size = 2 * num_loads;
+    std::vector<double> cost(size * size, kForbidden);
+    for (size_t from = 0; from < size; ++from) {
+        bool from_hq = (from >= num_loads);
+        size_t from_id = from_hq ? 0 : from + 1;
+        bool mandatory_driver = from_hq && (from - num_loads < _min_drivers);
+        for (size_t to = 0; to < size; ++to) {
+            bool to_hq = (to >= num_loads);
+            size_t to_id = to_hq ? 0 : to + 1;
+            double& entry = cost[from * size + to];
+            if (!from_hq && !to_hq) {
+                if (from_id != to_id) {
+                    entry = minute_weight * matrix[from_id][to_id];
+                }
+            } else if (from_hq && !to_hq) {
+                entry = driver_cost + minute_weight * matrix[0][to_id];
+            } else if (!from_hq && to_hq) {
+                entry = minute_weight * matrix[from_id][0];
+            } else if (!mandatory_driver) {
+                // an unused driver
+                entry = 0;
+            }
+        }
+    }
+    return solve_assignment(cost, size);
+}
+
+long double LowerBound::gap(long double cost) const {
+    if (cost <= 0 || cost == std::numeric_limits<long double>::infinity()) {
+        return (cost <= _bound) ? 0 : std::numeric_limits<long double>::infinity();
+    }
+    return std::max(0.L, (cost - _bound) / cost);
+}
+
+double LowerBound::solve_assignment(const std::vector<double>& cost, size_t size) {
+    // Shortest augmenting path version of the Hungarian algorithm with row/column potentials, O(size^3).
+    // Arrays are 1-indexed, with index 0 a dummy column that the augmenting path starts from.
+    std::vector<double> row_potential(size + 1, 0);
+    std::vector<double> col_potential(size + 1, 0);
+    std::vector<size_t> col_match(size + 1, 0);  // row assigned to each column, 0 if none yet
+    std::vector<size_t> way(size + 1, 0);
+    std::vector<double> min_slack(size + 1);
+    std::vector<char> used(size + 1);
+
+    for (size_t row = 1; row <= size; ++row) {
+        col_match[0] = row;
+        size_t col = 0;
+        std::fill(min_slack.begin(), min_slack.end(), std::numeric_limits<double>::infinity());
+        std::fill(used.begin(), used.end(), 0);
+        do {
+            used[col] = 1;
+            size_t matched_row = col_match[col];
+            const double* cost_row = &cost[(matched_row - 1) * size];
+            double delta = std::numeric_limits<double>::infinity();
+            size_t next_col = 0;
+            for (size_t candidate = 1; candidate <= size; ++candidate) {
+                if (used[candidate]) {
+                    continue;
+                }
+                double slack = cost_row[candidate - 1] - row_potential[matched_row] - col_potential[candidate];
+                if (slack < min_slack[candidate]) {
+                    min_slack[candidate] = slack;
+                    way[candidate] = col;
+                }
+                if (min_slack[candidate] < delta) {
+                    delta = min_slack[candidate];
+                    next_col = candidate;
+                }
+            }
+            for (size_t candidate = 0; candidate <= size; ++candidate) {
+                if (used[candidate]) {
+                    row_potential[col_match[candidate]] += delta;
+                    col_potential[candidate] -= delta;
+                } else {
+                    min_slack[candidate] -= delta;
+                }
+            }
+            col = next_col;
+        } while (col_match[col] != 0);
+
+        // flip the augmenting path
+        do {
+            size_t prev_col = way[col];
+            col_match[col] = col_match[prev_col];
+            col = prev_col;
+        } while (col != 0);
+    }
+
+    double total = 0;
+    for (size_t col = 1; col <= size; ++col) {
+        total += cost[(col_match[col] - 1) * size + col - 1];
+    }
+    return total;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <vector>
+
+#include "distance_matrix.h"
+
+// Lower bound on 500*drivers + minutes for any valid solution, so we can tell how far an incumbent could
+// possibly be from optimal (and quit searching once it's close enough).
+//
+// Two pieces go into it:
+//   - A minimum driver count. Every load needs at least its cheapest incoming leg (which includes its own
+//     pickup-to-dropoff minutes), and every driver needs at least the cheapest leg back to HQ, none of which
+//     can exceed max_minutes per driver.
+//   - An assignment problem relaxation on the distance matrix successor costs. Each load picks one successor
+//     and one predecessor. HQ is split into one copy per possible driver, where leaving a copy towards a load
+//     costs an extra 500 (ie hiring that driver), and unused copies just point at each other for free. The
+//     first min_drivers copies aren't allowed to be unused. Without the "no subtours" constraint, the optimal
+//     assignment can't cost more than any real solution.
+//   - The same relaxation with max_minutes folded in by a Lagrange multiplier, since on its own the assignment
+//     ignores the time limit and gets away with too few drivers. With drivers free it's also a bound on total
+//     minutes, which can raise the minimum driver count above.
+//
+// The relaxations are O(n^3) each. Given a deadline, compute() only spends kMaxDeadlineShare of the time left
+// on them: it times the first one and skips whatever wouldn't fit in that share (the driver count first, then
+// golden section steps, then the full relaxation), falling back on the weaker bounds.
+class LowerBound {
+public:
+    // The assignment relaxation is O(n^3), above this many loads we only use the cheaper bounds
+    static constexpr size_t kMaxAssignmentLoads = 500;
+
+    // Search range for the Lagrange multiplier on max_minutes, and how many relaxations to spend finding it
+    static constexpr double kMaxMultiplier = 3.0;
+    static constexpr size_t kMultiplierSteps = 10;
+
+    // Most of the time left before the deadline belongs to the search, the bound only gets this much of it
+    static constexpr double kMaxDeadlineShare = 0.1;
+
+    LowerBound(const DistanceMatrix* distance_matrix, long double max_minutes, std::ofstream* log)
+    : _distance_matrix(distance_matrix)
+    , _max_minutes(max_minutes)
+    , _log(log)
+    , _deadline(std::chrono::steady_clock::time_point::max()) {}
+
+    // compute() settles for a weaker bound rather than eat into the time before this (see above)
+    void set_deadline(std::chrono::steady_clock::time_point deadline) {
+        _deadline = deadline;
+    }
+
+    void compute();
+
+    size_t min_drivers() const {
+        return _min_drivers;
+    }
+
+    long double bound() const {
+        return _bound;
+    }
+
+    // Relative gap between a solution cost and the bound, ie 0 means cost is provably optimal
+    long double gap(long double cost) const;
+
+private:
+    const DistanceMatrix* _distance_matrix;
+    long double _max_minutes;
+    std::ofstream* _log;
+    std::chrono::steady_clock::time_point _deadline;
+
+    size_t _min_drivers = 0;
+    long double _bound = 0;
+
+    // The assignment relaxation with each driver costing driver_cost (instead of 500) and every leg's minutes
+    // multiplied by minute_weight
+    double relaxation(double driver_cost, double minute_weight) const;
+
+    // A smaller (num_loads square, so about 8x quicker) version of relaxation(), without HQ copies and so
+    // without min_drivers
+    double compact_relaxation(double driver_cost, double minute_weight) const;
+
+    // The compact relaxation with multiplier times (minutes - max_minutes * drivers) added to the cost
+    long double lagrangian_bound(double multiplier) const;
+
+    // Solves the square assignment problem over cost (size x size, row major) with the Hungarian algorithm,
+    // returning the minimum total cost
+    static double solve_assignment(const std::vector<double>& cost, size_t size);
+};
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+
+#include "exact_solver.h"
+#include "graph.h"
+#include "lower_bound.h"
+#include "test_instances.h"
+
+namespace {
+
+const long double kMaxMinutes = 12 * 60;
+
+std::ofstream test_log;  // never opened, so logging goes nowhere
+
+}  // namespace
+
+TEST(LowerBoundTests, NeverAboveTheOptimum) {
+    for (uint32_t seed = 1; seed <= 20; ++seed) {
+        // a mix of sizes and spreads, so some instances need several drivers and some just one
+        size_t num_loads = 4 + seed % 9;
+        long double spread = (seed % 2) ? 125 : 60;
+        Graph graph({}, &test_log, kMaxMinutes);
+        graph.reset(random_coordinates(seed, num_loads, spread));
+
+        ExactSolver exact(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+        std::vector<std::vector<size_t>> routes;
+        ASSERT_TRUE(exact.solve(routes));
+        double optimum = 0;
+        for (const auto& route : routes) {
+            optimum += 500 + route_minutes(graph.getDistanceMatrix(), route);
+        }
+
+        LowerBound lower_bound(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+        lower_bound.compute();
+        EXPECT_GT(lower_bound.bound(), 0) << "seed " << seed;
+        EXPECT_LE(lower_bound.bound(), optimum) << "seed " << seed;
+        EXPECT_LE(lower_bound.min_drivers(), routes.size()) << "seed " << seed;
+    }
+}
+
+TEST(LowerBoundTests, GapIsRelativeToTheCost) {
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(3, 10));
+    LowerBound lower_bound(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+    lower_bound.compute();
+    long double bound = lower_bound.bound();
+    EXPECT_EQ(lower_bound.gap(bound), 0);
+    EXPECT_NEAR(lower_bound.gap(2 * bound), 0.5, 1e-9);
+    EXPECT_EQ(lower_bound.gap(std::numeric_limits<long double>::infinity()), std::numeric_limits<long double>::infinity());
+}
+
+TEST(LowerBoundTests, NoLoadsNoCost) {
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(1, 0));
+    LowerBound lower_bound(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+    lower_bound.compute();
+    EXPECT_EQ(lower_bound.bound(), 0);
+    EXPECT_EQ(lower_bound.min_drivers(), 0u);
+}
+
+TEST(LowerBoundTests, DeadlineOnlyWeakensTheBound) {
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(4, 60));
+    LowerBound full(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+    full.compute();
+
+    // no time at all leaves just the simple bound, which is still a bound
+    LowerBound rushed(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+    rushed.set_deadline(std::chrono::steady_clock::now());
+    rushed.compute();
+    EXPECT_GT(rushed.bound(), 0);
+    EXPECT_LE(rushed.bound(), full.bound());
+    EXPECT_LE(rushed.min_drivers(), full.min_drivers());
+
+    // plenty of time is the same as no deadline
+    LowerBound relaxed(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+    relaxed.set_deadline(std::chrono::steady_clock::now() + std::chrono::hours(1));
+    relaxed.compute();
+    EXPECT_EQ(relaxed.bound(), full.bound());
+    EXPECT_EQ(relaxed.min_drivers(), full.min_drivers());
+}
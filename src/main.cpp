@@ -1,14 +1,22 @@
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "decomposition.h"
 #include "evaluate_shared.h"
 #include "graph.h"
+#include "instance_file.h"
+#include "server.h"
+#include "solver.h"
+#include "thread_pool.h"
 #include <limits>
 
 int main(int argc, char** argv) {
+    // time budgets count from here, so they include loading the problem
+    auto start = std::chrono::steady_clock::now();
     std::ofstream logstream("debug-log.out");
 #if LOGGING
     logstream << "Vehicle Routing Debug Log" << std::endl;
@@ -22,122 +30,143 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    // NOTE: Considering 64-bit random generator, but worried about runtime, so sticking to standard mt19937 for now
-    std::random_device rd;
-    std::mt19937 gen(rd());
-
-    std::ifstream infile(argv[1]);
-    std::string line;
-    std::vector<std::string> lines;
-    while (std::getline(infile, line))
-    {
-        lines.push_back(line);
+    // Arguments besides the input file:
+    //   --gap <fraction>        stop searching once the best solution is provably within this fraction of optimal
+    //   --budget <ms>           stop searching this long after startup and output the best solution so far (by
+    //                           default the search runs its course)
+    //   --serve <socket_path>   run as a server on a Unix domain socket instead of solving a single file
+    //   --serve-stdio           run as a server over stdin/stdout instead of solving a single file
+    //   --workers <count>       number of solver threads (defaults to one per hardware thread)
+    //   --convert <output>      write the input file out as a binary instance file (see instance_file.h) and exit
+    //   --no-matrix             leave the distance matrix out of the converted file
+    //   --verify-matrix         check a binary input file's distance matrix checksum before using it
+    //   --decompose <method>    split the loads into clusters (method is sweep or kmeans) and solve them in parallel,
+    //                           for instances too big to search as a whole (see decomposition.h)
+    //   --cluster-size <count>  roughly how many loads go in each cluster (defaults to 100)
+    //   --no-repair             skip moving loads between neighbouring clusters after they're solved
+    long double target_gap = 0.01;
+    long long budget_ms = 0;
+    std::string input_file;
+    std::string socket_path;
+    bool serve_stdio = false;
+    size_t num_workers = 0;
+    std::string convert_output;
+    bool include_matrix = true;
+    bool verify_matrix = false;
+    bool decompose = false;
+    Decomposition::Method decompose_method = Decomposition::Method::Sweep;
+    size_t cluster_size = Decomposition::kDefaultClusterSize;
+    bool repair = true;
+    for (int ii = 1; ii < argc; ++ii) {
+        std::string arg = argv[ii];
+        if (arg == "--gap" && ii + 1 < argc) {
+            target_gap = std::stold(argv[++ii]);
+        } else if (arg == "--budget" && ii + 1 < argc) {
+            budget_ms = std::stoll(argv[++ii]);
+        } else if (arg == "--serve" && ii + 1 < argc) {
+            socket_path = argv[++ii];
+        } else if (arg == "--serve-stdio") {
+            serve_stdio = true;
+        } else if (arg == "--workers" && ii + 1 < argc) {
+            num_workers = std::stoul(argv[++ii]);
+        } else if (arg == "--convert" && ii + 1 < argc) {
+            convert_output = argv[++ii];
+        } else if (arg == "--no-matrix") {
+            include_matrix = false;
+        } else if (arg == "--verify-matrix") {
+            verify_matrix = true;
+        } else if (arg == "--decompose" && ii + 1 < argc) {
+            decompose = true;
+            if (!Decomposition::parse_method(argv[++ii], decompose_method)) {
+                std::cerr << "Unknown decomposition method " << argv[ii] << ", expected sweep or kmeans" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--cluster-size" && ii + 1 < argc) {
+            cluster_size = std::stoul(argv[++ii]);
+        } else if (arg == "--no-repair") {
+            repair = false;
+        } else {
+            input_file = arg;
+        }
     }
-    infile.close();
 
     long double maxMinutes = 12*60;
-    Graph g(lines, &logstream, maxMinutes);
-    g.build();
-
-#if LOGGING
-    g.debug();
-    int many = 60;
-    int some = 30;
-    int few = 10;
-#else
-    int many = 360;
-    int some = 180;
-    int few = 60;
-#endif
+    // the single file and decomposition solves both stop here
+    auto deadline = (budget_ms > 0) ? start + std::chrono::milliseconds(budget_ms) : std::chrono::steady_clock::time_point::max();
 
+    if (serve_stdio || !socket_path.empty()) {
+        Server server(num_workers, maxMinutes, target_gap);
+        int status = serve_stdio ? server.serve_stdio() : server.serve_socket(socket_path);
+        logstream.close();
+        return status;
+    }
 
-    std::vector<std::pair<Probs, int>> stuff_to_try = {
-        // {Probs(&gen, 1, 0, 0, 0, 0), 1},  // do this once (deterministic solution): always go to HQ, each worker never delivers more than 1 load
-        {Probs(&gen, 0, 1, 0, 0, 0, false), 1},  // do this once (deterministic solution): always greedily deliver the nearest load with a single driver, maximizes load per driver
-        {Probs(&gen, 0, 0, 1, 0, 0, false), 1},  // do this once (deterministic solution): always greedily deliver the nearest load that's father from HQ (falls back to nearest load), maximizes load per driver
-        {Probs(&gen, 0, 0, 0, 1, 0, false), many}, // do this many times: always go to weighted nearest neighbor if possible, with closer neighbors having higher probability
-        {Probs(&gen, 0, 0, 0, 0, 1, false), many}, // do this many times: always go to a random neighbor if possible
-        {Probs(&gen, 10, 90, 100, 0, 0, false), many}, // do this many times: greedily deliver nearest load with a chance to return early to HQ
-        {Probs(&gen, 10, 0, 0, 190, 0, false), many}, // do this many times: weighted neighbor with a chance to return early to HQ
-        {Probs(&gen, 10, 0, 0, 0, 190, false), many}, // do this many times: random with chance to return early to HQ
-        {Probs(&gen, 10, 45, 45, 100, 0, false), some}, // do this some number of times: weighted btw nearest neighbor vs weighted nearest with a chance to return early to HQ
-        {Probs(&gen, 10, 45, 45, 0, 100, false), some}, // do this some number of times: weighted btw nearest neighbor vs random neighbor with a chance to return early to HQ
-        {Probs(&gen, 100, 16, 16, 18, 50, false), some}, // do this some number of times: bail to HQ half the time, random neighbor quarter of the time, otherwise other schemes
-
-        {Probs(&gen, 0, 1, 0, 0, 0, true), few},  // few times deterministic nearest neighbor w different starting points, maximize load per driver
-        {Probs(&gen, 0, 0, 1, 0, 0, true), few},  // few times deterministic nearest load that's father from HQ, but different starting points
-        {Probs(&gen, 10, 90, 0, 0, 0, true), few},  // few times nearest neighbors, 10% chance of early exit, different starting points
-        {Probs(&gen, 10, 0, 90, 0, 0, true), few},  // few times nearest neighbors farther from HG, 10% chance of early exit, different starting points
-        {Probs(&gen, 10, 45, 45, 100, 0, true), some}, // do this some number of times: different starting points, but weighted btw nearest neighbor vs weighted nearest with a chance to return early to HQ
-        {Probs(&gen, 10, 45, 45, 0, 100, true), some}, // do this some number of times: different starting points, but weighted btw nearest neighbor vs random neighbor with a chance to return early to HQ
-        {Probs(&gen, 100, 16, 16, 18, 50, true), some}, // do this some number of times: different starting points, but bail to HQ half the time, random neighbor quarter of the time, otherwise other schemes
-
-    };
-    
-    long double lowest_cost = std::numeric_limits<long double>::infinity();
+    // NOTE: Considering 64-bit random generator, but worried about runtime, so sticking to standard mt19937 for now
+    std::random_device rd;
+    std::mt19937 gen(rd());
 
-    std::vector<Coordinate> coordinates = g.getCoordinates();
-    std::vector<std::vector<size_t>> best_solution;
-    
-    // Try a solution that involves giving 1 load to each worker
-    for (size_t ii = 1; ii < lines.size(); ++ii) {
-        best_solution.push_back({ii});
+    // Text problems get parsed, binary instance files get mapped in (including the distance matrix, if they have one)
+    Graph g(std::vector<std::string>(), &logstream, maxMinutes);
+    std::string error;
+    if (decompose && convert_output.empty()) {
+        // Only the clusters get distance matrices, the whole problem may well be too big for one
+        if (g.load_coordinates(input_file, error) != 0) {
+            std::cerr << error << std::endl;
+            logstream.close();
+            return 1;
+        }
+        Decomposition decomposition(&gen, maxMinutes, target_gap, decompose_method, cluster_size, repair, num_workers);
+        decomposition.set_deadline(deadline);
+        SolverResult result;
+        if (decomposition.solve(g.getCoordinates(), result) != 0) {
+            logstream.close();
+            return 1;
+        }
+        std::cerr << "gap: " << 100 * result.gap << "% (cost " << result.cost << ")" << std::endl;
+        EvaluateShared::outputSolutionSchedules(result.solution);
+        logstream.close();
+        return 0;
     }
-    if (EvaluateShared::validateSolutionSchedules(best_solution, g.numCoordinates()) != 0) {
-        // Uh oh that failed validation??? That's not good. Exit with error.
-#if LOGGING
-        logstream << "fallback solution failed, bailing" << std::endl;
-#endif
+    if (g.load(input_file, error, verify_matrix) != 0) {
+        std::cerr << error << std::endl;
         logstream.close();
         return 1;
-    } else {
-        // Awesome! It worked! That's our lowest cost we will use against the stuff_to_try attempts mentioned above.
-        lowest_cost = EvaluateShared::getSolutionCost(coordinates, best_solution, maxMinutes);
     }
 
-#if LOGGING
-    logstream << "lowest_cost = " << lowest_cost << std::endl;
-#endif
-
-    // For each item in stuff_to_try, run w the probs parameters a # of times specified by num_times (there's randomness involved)
-    // Anytime we get something better than the best_solution, we keep that solution
-    for (auto& try_it : stuff_to_try) {
-        Probs& probs = try_it.first;
-        int num_times = try_it.second;
-        for (int ii = 0; ii < num_times; ++ii) {
-            auto candidate_solution = g.plan_paths(probs);
-#if LOGGING
-            logstream << "Considering candidate solution:" << std::endl;
-            EvaluateShared::outputScheduleToLog(&logstream, candidate_solution);
-#endif
+    if (!convert_output.empty()) {
+        int status = InstanceFile::write(convert_output, g.getCoordinates(), include_matrix ? &g.getDistanceMatrix() : nullptr);
+        if (status != 0) {
+            std::cerr << "Unable to write " << convert_output << std::endl;
+        } else if (!InstanceFile::open(convert_output, /* verify_matrix_checksum = */ true, error)) {
+            // read it back, checking every section, so a bad write shows up now rather than on some later solve
+            std::cerr << error << std::endl;
+            status = 1;
+        }
+        logstream.close();
+        return status;
+    }
 
-            int status = EvaluateShared::validateSolutionSchedules(candidate_solution, g.numCoordinates());
-            if (status == 0) {
-                long double candidate_cost = EvaluateShared::getSolutionCost(coordinates, candidate_solution, maxMinutes);
 #if LOGGING
-                logstream << "Candidate passes validation" << std::endl;
-                logstream << "candidate_cost = " << candidate_cost << std::endl;
+    g.debug();
 #endif
 
-                if (candidate_cost < lowest_cost) {
-                    best_solution = candidate_solution;
-                    lowest_cost = candidate_cost;
-#if LOGGING
-                    logstream << "We found a new best solution" << std::endl;
-                    logstream << "Probs is " << probs.to_string() << std::endl;
-                    logstream << "lowest_cost = " << lowest_cost << std::endl;
-#endif
-                }
-            } else {
-#if LOGGING
-                logstream << "Candidate fails validation" << std::endl;
-#endif
-            }
-        }
+    // Only the single file solve gets a pool for resequencing routes, the server and decomposition already run a Solver per thread
+    ThreadPool pool(num_workers);
+    Solver solver(&gen, &logstream, maxMinutes, target_gap);
+    solver.set_thread_pool(&pool);
+    solver.set_deadline(deadline);
+    SolverResult result;
+    if (solver.solve(g, result) != 0) {
+        // Uh oh, not even the fallback solution passed validation. Exit with error.
+        logstream.close();
+        return 1;
     }
 
+    // stdout is reserved for the solution, so the gap goes to stderr
+    std::cerr << "gap: " << 100 * result.gap << "% (cost " << result.cost << ")" << std::endl;
+
     // output our best answer!!!
-    EvaluateShared::outputSolutionSchedules(best_solution);
+    EvaluateShared::outputSolutionSchedules(result.solution);
 
     logstream.close();
     return 0;
@@ -0,0 +1,183 @@
+#include "masked_argmin.h"
+
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MASKED_ARGMIN_X86 1
+#include <immintrin.h>
+#else
+#define MASKED_ARGMIN_X86 0
+#endif
+
+namespace {
+
+using Kernel = size_t (*)(const double*, const double*, const uint8_t*, size_t, double);
+
+// Picks the best of the per lane winners, the lowest index among equal distances. Lanes that never found
+// anything still hold infinity and index 0.
+size_t reduce_lanes(const double* best, const int64_t* best_index, size_t lanes) {
+    double nearest = std::numeric_limits<double>::infinity();
+    size_t nearest_index = 0;
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        if (best[lane] < nearest || (best[lane] == nearest && best_index[lane] != 0 && static_cast<size_t>(best_index[lane]) < nearest_index)) {
+            nearest = best[lane];
+            nearest_index = static_cast<size_t>(best_index[lane]);
+        }
+    }
+    return nearest_index;
+}
+
+// Finishes off from index start one element at a time, continuing from the best found so far
+size_t scalar_from(const double* row, const double* onway_row, const uint8_t* available, size_t start, size_t size, double budget, double nearest, size_t nearest_index) {
+    for (size_t jj = start; jj < size; ++jj) {
+        double distance = row[jj];
+        bool ok = available[jj] && (distance < budget) && (distance < nearest) && (!onway_row || distance < onway_row[jj]);
+        if (ok) {
+            nearest = distance;
+            nearest_index = jj;
+        }
+    }
+    return nearest_index;
+}
+
+size_t masked_argmin_scalar(const double* row, const double* onway_row, const uint8_t* available, size_t size, double budget) {
+    return scalar_from(row, onway_row, available, 1, size, budget, std::numeric_limits<double>::infinity(), 0);
+}
+
+#if MASKED_ARGMIN_X86
+
+// One 4 wide step of the AVX2 loop, for the distances starting at jj
+__attribute__((target("avx2"), always_inline)) inline
+void avx2_step(const double* row, const double* onway_row, const uint8_t* available, size_t jj, __m256d budget_vector, __m256i index, __m256d& best, __m256i& best_index) {
+    __m256d distance = _mm256_loadu_pd(row + jj);
+    int32_t mask_bytes;
+    std::memcpy(&mask_bytes, available + jj, sizeof(mask_bytes));
+    __m256i is_available = _mm256_cmpgt_epi64(_mm256_cvtepu8_epi64(_mm_cvtsi32_si128(mask_bytes)), _mm256_setzero_si256());
+
+    __m256d ok = _mm256_and_pd(_mm256_castsi256_pd(is_available), _mm256_cmp_pd(distance, budget_vector, _CMP_LT_OQ));
+    ok = _mm256_and_pd(ok, _mm256_cmp_pd(distance, best, _CMP_LT_OQ));
+    if (onway_row) {
+        ok = _mm256_and_pd(ok, _mm256_cmp_pd(distance, _mm256_loadu_pd(onway_row + jj), _CMP_LT_OQ));
+    }
+    best = _mm256_blendv_pd(best, distance, ok);
+    best_index = _mm256_castpd_si256(_mm256_blendv_pd(_mm256_castsi256_pd(best_index), _mm256_castsi256_pd(index), ok));
+}
+
+__attribute__((target("avx2")))
+size_t masked_argmin_avx2(const double* row, const double* onway_row, const uint8_t* available, size_t size, double budget) {
+    // Two independent sets of lanes, otherwise every step waits on the previous step's blend
+    const __m256d budget_vector = _mm256_set1_pd(budget);
+    const __m256i step = _mm256_set1_epi64x(8);
+    __m256d best[2] = {_mm256_set1_pd(std::numeric_limits<double>::infinity()), _mm256_set1_pd(std::numeric_limits<double>::infinity())};
+    __m256i best_index[2] = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+    __m256i index[2] = {_mm256_setr_epi64x(1, 2, 3, 4), _mm256_setr_epi64x(5, 6, 7, 8)};
+
+    size_t jj = 1;
+    for (; jj + 8 <= size; jj += 8) {
+        avx2_step(row, onway_row, available, jj, budget_vector, index[0], best[0], best_index[0]);
+        avx2_step(row, onway_row, available, jj + 4, budget_vector, index[1], best[1], best_index[1]);
+        index[0] = _mm256_add_epi64(index[0], step);
+        index[1] = _mm256_add_epi64(index[1], step);
+    }
+
+    alignas(32) double lane_best[8];
+    alignas(32) int64_t lane_index[8];
+    for (size_t half = 0; half < 2; ++half) {
+        _mm256_store_pd(lane_best + 4 * half, best[half]);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lane_index + 4 * half), best_index[half]);
+    }
+    size_t nearest_index = reduce_lanes(lane_best, lane_index, 8);
+    double nearest = nearest_index ? row[nearest_index] : std::numeric_limits<double>::infinity();
+    return scalar_from(row, onway_row, available, jj, size, budget, nearest, nearest_index);
+}
+
+__attribute__((target("avx512f")))
+size_t masked_argmin_avx512(const double* row, const double* onway_row, const uint8_t* available, size_t size, double budget) {
+    const __m512d budget_vector = _mm512_set1_pd(budget);
+    const __m512i step = _mm512_set1_epi64(8);
+    __m512d best = _mm512_set1_pd(std::numeric_limits<double>::infinity());
+    __m512i best_index = _mm512_setzero_si512();
+    __m512i index = _mm512_setr_epi64(1, 2, 3, 4, 5, 6, 7, 8);
+
+    size_t jj = 1;
+    for (; jj + 8 <= size; jj += 8) {
+        __m512d distance = _mm512_loadu_pd(row + jj);
+        // the maskz form only because gcc warns about the undefined source the plain _mm512_cvtepu8_epi64 uses
+        __m512i mask_bytes = _mm512_maskz_cvtepu8_epi64(0xFF, _mm_loadl_epi64(reinterpret_cast<const __m128i*>(available + jj)));
+        __mmask8 ok = _mm512_test_epi64_mask(mask_bytes, mask_bytes);
+        ok &= _mm512_cmp_pd_mask(distance, budget_vector, _CMP_LT_OQ);
+        ok &= _mm512_cmp_pd_mask(distance, best, _CMP_LT_OQ);
+        if (onway_row) {
+            ok &= _mm512_cmp_pd_mask(distance, _mm512_loadu_pd(onway_row + jj), _CMP_LT_OQ);
+        }
+        best = _mm512_mask_mov_pd(best, ok, distance);
+        best_index = _mm512_mask_mov_epi64(best_index, ok, index);
+        index = _mm512_add_epi64(index, step);
+    }
+
+    alignas(64) double lane_best[8];
+    alignas(64) int64_t lane_index[8];
+    _mm512_store_pd(lane_best, best);
+    _mm512_store_si512(lane_index, best_index);
+    size_t nearest_index = reduce_lanes(lane_best, lane_index, 8);
+    double nearest = nearest_index ? row[nearest_index] : std::numeric_limits<double>::infinity();
+    return scalar_from(row, onway_row, available, jj, size, budget, nearest, nearest_index);
+}
+
+#endif
+
+struct Dispatch {
+    Kernel kernel;
+    const char* isa;
+
+    Dispatch()
+    : kernel(masked_argmin_scalar)
+    , isa("scalar") {
+#if MASKED_ARGMIN_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            kernel = masked_argmin_avx512;
+            isa = "avx512";
+        } else if (__builtin_cpu_supports("avx2")) {
+            kernel = masked_argmin_avx2;
+            isa = "avx2";
+        }
+#endif
+    }
+};
+
+const Dispatch& dispatch() {
+    static const Dispatch instance;
+    return instance;
+}
+
+}  // namespace
+
+size_t masked_argmin(const double* row, const double* onway_row, const uint8_t* available, size_t size, double budget) {
+    return dispatch().kernel(row, onway_row, available, size, budget);
+}
+
+const char* masked_argmin_isa() {
+    return dispatch().isa;
+}
+
+bool masked_argmin_using(const char* isa, const double* row, const double* onway_row, const uint8_t* available, size_t size, double budget, size_t& result) {
+    Kernel kernel = nullptr;
+    if (std::strcmp(isa, "scalar") == 0) {
+        kernel = masked_argmin_scalar;
+    }
+#if MASKED_ARGMIN_X86
+    __builtin_cpu_init();
+    if (std::strcmp(isa, "avx512") == 0 && __builtin_cpu_supports("avx512f")) {
+        kernel = masked_argmin_avx512;
+    } else if (std::strcmp(isa, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        kernel = masked_argmin_avx2;
+    }
+#endif
+    if (!kernel) {
+        return false;
+    }
+    result = kernel(row, onway_row, available, size, budget);
+    return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// The inner step of the greedy schemes: over one row of the distance matrix, find the nearest load that's
+// still unassigned and can be reached within the remaining minutes, all in a single pass over contiguous
+// memory. Picks an AVX-512 or AVX2 version at runtime when the CPU has it, otherwise a plain loop.
+
+// Returns the j in [1, size) with the smallest row[j] such that available[j] is nonzero and row[j] < budget.
+// If onway_row isn't null, j also has to satisfy row[j] < onway_row[j] (ie closer to us than to HQ when
+// onway_row is HQ's row). Ties go to the lowest j. Returns 0 if no j qualifies.
+size_t masked_argmin(const double* row, const double* onway_row, const uint8_t* available, size_t size, double budget);
+
+// Which version masked_argmin() runs ("avx512", "avx2" or "scalar"), for the debug log
+const char* masked_argmin_isa();
+
+// Same as masked_argmin(), but on the given version rather than the one picked for this CPU, so the versions
+// can be checked against each other. Returns false (leaving result alone) if the CPU can't run that version.
+bool masked_argmin_using(const char* isa, const double* row, const double* onway_row, const uint8_t* available, size_t size, double budget, size_t& result);
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "masked_argmin.h"
+
+namespace {
+
+// Straight from the definition in masked_argmin.h, with nothing clever to get wrong
+size_t reference_argmin(const std::vector<double>& row, const std::vector<double>* onway_row, const std::vector<uint8_t>& available, double budget) {
+    size_t nearest_index = 0;
+    for (size_t jj = 1; jj < row.size(); ++jj) {
+        bool ok = available[jj] && row[jj] < budget && (!onway_row || row[jj] < (*onway_row)[jj]);
+        if (ok && (nearest_index == 0 || row[jj] < row[nearest_index])) {
+            nearest_index = jj;
+        }
+    }
+    return nearest_index;
+}
+
+// Every version the CPU can run has to agree with the reference (and so with each other) on random rows. Distances
+// are small whole numbers so there are plenty of ties, which have to go to the lowest index in every version.
+void expect_versions_agree(const char* isa) {
+    size_t result = 0;
+    std::vector<double> probe(2, 1.0);
+    std::vector<uint8_t> probe_available(2, 1);
+    if (!masked_argmin_using(isa, probe.data(), nullptr, probe_available.data(), probe.size(), 10.0, result)) {
+        GTEST_SKIP() << "CPU can't run the " << isa << " version";
+    }
+
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<int> distance(0, 20);
+    std::uniform_int_distribution<int> coin(0, 3);
+    // sizes either side of the vector widths, so the scalar tail gets exercised too
+    for (size_t size : {0, 1, 2, 5, 8, 9, 15, 16, 17, 23, 64, 65, 1000, 1003}) {
+        for (int trial = 0; trial < 50; ++trial) {
+            std::vector<double> row(size), onway_row(size);
+            std::vector<uint8_t> available(size);
+            for (size_t jj = 0; jj < size; ++jj) {
+                row[jj] = distance(gen);
+                onway_row[jj] = distance(gen);
+                available[jj] = (coin(gen) != 0);
+            }
+            double budget = (trial % 5 == 0) ? 1e9 : distance(gen);
+            for (bool onway : {false, true}) {
+                size_t expected = reference_argmin(row, onway ? &onway_row : nullptr, available, budget);
+                ASSERT_TRUE(masked_argmin_using(isa, row.data(), onway ? onway_row.data() : nullptr, available.data(), size, budget, result));
+                EXPECT_EQ(result, expected) << isa << " size " << size << " trial " << trial << " onway " << onway;
+            }
+        }
+    }
+}
+
+}  // namespace
+
+TEST(MaskedArgminTests, ScalarMatchesReference) {
+    expect_versions_agree("scalar");
+}
+
+TEST(MaskedArgminTests, Avx2MatchesReference) {
+    expect_versions_agree("avx2");
+}
+
+TEST(MaskedArgminTests, Avx512MatchesReference) {
+    expect_versions_agree("avx512");
+}
+
+TEST(MaskedArgminTests, DispatchMatchesItsVersion) {
+    std::vector<double> row = {0, 5, 3, 3, 7, 1, 1, 9, 2, 1};
+    std::vector<uint8_t> available = {0, 1, 1, 1, 1, 0, 1, 1, 1, 1};
+    size_t result = 0;
+    ASSERT_TRUE(masked_argmin_using(masked_argmin_isa(), row.data(), nullptr, available.data(), row.size(), 100.0, result));
+    EXPECT_EQ(masked_argmin(row.data(), nullptr, available.data(), row.size(), 100.0), result);
+    EXPECT_EQ(result, 6u);
+    EXPECT_FALSE(masked_argmin_using("sse9", row.data(), nullptr, available.data(), row.size(), 100.0, result));
+}
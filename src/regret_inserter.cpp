@@ -0,0 +1,260 @@
+#include "regret_inserter.h"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+namespace {
+
+// Below this many loads, splitting a refresh across the pool costs more than it saves
+constexpr size_t kParallelMinLoads = 1024;
+constexpr size_t kLoadsPerTask = 256;
+
+}  // namespace
+
+RegretInserter::RegretInserter(const DistanceMatrix* distance_matrix, long double max_minutes, std::ofstream* log)
+: _distance_matrix(distance_matrix)
+, _max_minutes(max_minutes)
+, _log(log)
+, _pool(nullptr)
+, _deadline(std::chrono::steady_clock::time_point::max())
+, _k(2) {}
+
+double RegretInserter::cheapest_insertion(size_t route, uint32_t load, uint32_t& position) const {
+    const DistanceMatrix& matrix = *_distance_matrix;
+    const std::vector<uint32_t>& loads = _routes[route];
+    double budget = static_cast<double>(_max_minutes) - _route_minutes[route];
+    double best = std::numeric_limits<double>::infinity();
+    const double* from_load = matrix[load];
+    uint32_t previous = 0;
+    for (size_t spot = 0; spot <= loads.size(); ++spot) {
+        uint32_t next = (spot == loads.size()) ? 0 : loads[spot];
+        const double* from_previous = matrix[previous];
+        double extra = from_previous[load] + from_load[next] - from_previous[next];
+        if (extra < best && extra < budget) {
+            best = extra;
+            position = static_cast<uint32_t>(spot);
+        }
+        previous = next;
+    }
+    return best;
+}
+
+void RegretInserter::rescan_top(uint32_t load) {
+    Option* top = &_top[load * _k];
+    uint32_t size = 0;
+    for (const Option& option : _options[load]) {
+        if (size == _k && option.cost >= top[size - 1].cost) {
+            continue;
+        }
+        // insertion sort into the k best
+        uint32_t spot = (size < _k) ? size++ : size - 1;
+        while (spot > 0 && top[spot - 1].cost > option.cost) {
+            top[spot] = top[spot - 1];
+            --spot;
+        }
+        top[spot] = option;
+    }
+    _top_sizes[load] = size;
+}
+
+RegretInserter::QueueEntry RegretInserter::make_entry(uint32_t load) const {
+    // The k cheapest options, counting a new route as an option as many times as needed, since opening one
+    // route doesn't stop us opening another
+    const Option* top = &_top[load * _k];
+    size_t size = _top_sizes[load];
+    double open_cost = _open_costs[load];
+    double best = (size > 0) ? std::min(top[0].cost, open_cost) : open_cost;
+    double regret = 0;
+    size_t used = 0;
+    bool open_used = false;
+    for (size_t option = 0; option < _k; ++option) {
+        double cost;
+        if (used < size && (open_used || top[used].cost <= open_cost)) {
+            cost = top[used++].cost;
+        } else {
+            cost = open_cost;
+            open_used = true;
+        }
+        regret += cost - best;
+    }
+    bool opens_route = (size == 0 || top[0].cost >= open_cost);
+    return QueueEntry{regret, best, opens_route, load, _versions[load] + 1};
+}
+
+void RegretInserter::refresh_loads(size_t route, size_t first, size_t last, std::vector<uint32_t>& changed) {
+    changed.clear();
+    for (size_t index = first; index < last; ++index) {
+        uint32_t load = _unrouted[index];
+        Option option{0, static_cast<uint32_t>(route), 0};
+        option.cost = cheapest_insertion(route, load, option.position);
+        bool feasible = (option.cost != std::numeric_limits<double>::infinity());
+
+        // Only feasible options are kept, sorted by route
+        std::vector<Option>& options = _options[load];
+        auto it = std::lower_bound(options.begin(), options.end(), option.route, [](const Option& lhs, uint32_t rhs) {
+            return lhs.route < rhs;
+        });
+        bool cached = (it != options.end() && it->route == option.route);
+        if (feasible && cached) {
+            *it = option;
+        } else if (feasible) {
+            options.insert(it, option);
+        } else if (cached) {
+            options.erase(it);
+        }
+
+        Option* top = &_top[load * _k];
+        uint32_t size = _top_sizes[load];
+        bool in_top = false;
+        for (uint32_t spot = 0; spot < size; ++spot) {
+            in_top |= (top[spot].route == route);
+        }
+        if (in_top) {
+            // it might have gotten more expensive than a route that isn't in the top, so only a rescan will do
+            rescan_top(load);
+        } else if (feasible && (size < _k || option.cost < top[size - 1].cost)) {
+            uint32_t spot = (size < _k) ? size++ : size - 1;
+            while (spot > 0 && top[spot - 1].cost > option.cost) {
+                top[spot] = top[spot - 1];
+                --spot;
+            }
+            top[spot] = option;
+            _top_sizes[load] = size;
+        } else {
+            continue;
+        }
+        _entries[load] = make_entry(load);
+        changed.push_back(load);
+    }
+}
+
+void RegretInserter::refresh(size_t route) {
+    // The number of unrouted loads only goes down, so neither does the number of tasks, and _changed only
+    // allocates for the first few refreshes
+    size_t num_unrouted = _unrouted.size();
+    if (_pool && num_unrouted >= kParallelMinLoads) {
+        size_t num_tasks = (num_unrouted + kLoadsPerTask - 1) / kLoadsPerTask;
+        _changed.resize(num_tasks);
+        _pool->run_all(num_tasks, [&](size_t, size_t task_index) {
+            size_t first = task_index * kLoadsPerTask;
+            refresh_loads(route, first, std::min(first + kLoadsPerTask, num_unrouted), _changed[task_index]);
+        });
+    } else {
+        _changed.resize(1);
+        refresh_loads(route, 0, num_unrouted, _changed[0]);
+    }
+}
+
+bool RegretInserter::solve(size_t k, Solution& solution) {
+    const DistanceMatrix& matrix = *_distance_matrix;
+    size_t num_coordinates = matrix.size();
+    if (num_coordinates < 2 || k == 0) {
+        return false;
+    }
+    _k = k;
+    _routes.clear();
+    _route_minutes.clear();
+    _routed.assign(num_coordinates, 0);
+    _routed[0] = 1;  // HQ
+    _options.resize(num_coordinates);
+    for (std::vector<Option>& options : _options) {
+        options.clear();
+    }
+    _unrouted.resize(num_coordinates - 1);
+    _unrouted_index.resize(num_coordinates);
+    for (uint32_t load = 1; load < num_coordinates; ++load) {
+        _unrouted[load - 1] = load;
+        _unrouted_index[load] = load - 1;
+    }
+    _open_costs.assign(num_coordinates, 0);
+    _top.assign(num_coordinates * _k, Option{0, 0, 0});
+    _top_sizes.assign(num_coordinates, 0);
+    _versions.assign(num_coordinates, 0);
+    _entries.resize(num_coordinates);
+
+    std::priority_queue<QueueEntry> queue;
+    for (uint32_t load = 1; load < num_coordinates; ++load) {
+        double minutes = matrix[0][load] + matrix[load][0];
+        if (!(minutes < _max_minutes)) {
+            // nobody can do this load in time, shouldn't happen for a valid problem
+            return false;
+        }
+        _open_costs[load] = 500 + minutes;
+        queue.push(make_entry(load));
+        ++_versions[load];
+    }
+
+    size_t num_unrouted = num_coordinates - 1;
+    size_t num_pushes = num_unrouted;
+    while (num_unrouted > 0) {
+        if ((num_unrouted & 63) == 0 && std::chrono::steady_clock::now() >= _deadline) {
+#if LOGGING
+            *_log << "Regret insertion ran out of time with " << num_unrouted << " loads left" << std::endl;
+#endif
+            return false;
+        }
+        QueueEntry entry = queue.top();
+        queue.pop();
+        uint32_t load = entry.load;
+        if (_routed[load] || entry.version != _versions[load]) {
+            continue;
+        }
+
+        size_t route;
+        if (_top_sizes[load] > 0 && _top[load * _k].cost < _open_costs[load]) {
+            const Option& best = _top[load * _k];
+            route = best.route;
+            _routes[route].insert(_routes[route].begin() + best.position, load);
+            _route_minutes[route] += best.cost;
+        } else {
+            route = _routes.size();
+            _routes.emplace_back(1, load);
+            _route_minutes.push_back(_open_costs[load] - 500);
+        }
+        _routed[load] = 1;
+        --num_unrouted;
+        // swap it out of the unrouted list, and let go of its options
+        uint32_t last = _unrouted.back();
+        _unrouted[_unrouted_index[load]] = last;
+        _unrouted_index[last] = _unrouted_index[load];
+        _unrouted.pop_back();
+        std::vector<Option>().swap(_options[load]);
+
+        refresh(route);
+        for (const std::vector<uint32_t>& changed : _changed) {
+            for (uint32_t other : changed) {
+                ++_versions[other];
+                queue.push(_entries[other]);
+                ++num_pushes;
+            }
+        }
+
+        // Stale entries pile up, every so often throw them all out
+        if (queue.size() > 4 * num_coordinates) {
+            std::vector<QueueEntry> fresh;
+            fresh.reserve(num_unrouted);
+            while (!queue.empty()) {
+                if (!_routed[queue.top().load] && queue.top().version == _versions[queue.top().load]) {
+                    fresh.push_back(queue.top());
+                }
+                queue.pop();
+            }
+            queue = std::priority_queue<QueueEntry>(std::less<QueueEntry>(), std::move(fresh));
+        }
+    }
+
+    solution.clear();
+    for (const std::vector<uint32_t>& loads : _routes) {
+        solution.begin_route();
+        for (uint32_t load : loads) {
+            solution.push_load(load);
+        }
+    }
+#if LOGGING
+    *_log << "Regret-" << _k << " insertion built " << _routes.size() << " routes with " << num_pushes << " queue pushes" << std::endl;
+#else
+    (void)num_pushes;
+#endif
+    return true;
+}
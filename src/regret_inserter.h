@@ -0,0 +1,121 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#include "distance_matrix.h"
+#include "solution.h"
+#include "thread_pool.h"
+
+// Regret-k insertion: builds a whole solution in one pass by repeatedly inserting the load that would lose the
+// most by waiting, anywhere in any open route, rather than extending one driver's route at its end like the
+// Probs schemes do.
+//
+// Every load's options are its cheapest feasible insertion into each open route (extra minutes, staying under
+// max_minutes), plus opening a new route for it alone (500 plus that route's minutes). Its regret is how much
+// worse its 2nd through k-th best options are than its best, summed, so loads with one good option left get
+// placed before it's gone. The cheapest insertion into each route is cached per load, along with each load's k
+// best routes, and after an insertion only the cache entries for the route that changed get recomputed (in
+// parallel when there's a pool). Loads whose regret changed get pushed onto a priority queue again, stale
+// entries are skipped when popped.
+//
+// The cache only holds options for loads still unrouted, and only for routes they fit in. Routes fill up as
+// the solution grows, so that's far less than routes x loads. Still, every route change touches every
+// unrouted load, so this is quadratic in the number of loads. Past kMaxLoads it's not worth it, see
+// Decomposition for those.
+class RegretInserter {
+public:
+    static constexpr size_t kMaxLoads = 5000;
+
+    RegretInserter(const DistanceMatrix* distance_matrix, long double max_minutes, std::ofstream* log);
+
+    // Recomputes cache entries in parallel on pool, which mustn't be the pool running the caller (see
+    // ThreadPool::run_all). nullptr (the default) does it all on the calling thread.
+    void set_thread_pool(ThreadPool* pool) {
+        _pool = pool;
+    }
+
+    // Gives up (returning false) once this passes
+    void set_deadline(std::chrono::steady_clock::time_point deadline) {
+        _deadline = deadline;
+    }
+
+    // Builds a solution into solution using regret-k (k >= 1, 1 being plain cheapest insertion). Returns false,
+    // leaving solution alone, on trouble or when out of time.
+    bool solve(size_t k, Solution& solution);
+
+private:
+    // A route a load could go into, how many minutes that would add, and where in the route it'd go
+    struct Option {
+        double cost;
+        uint32_t route;
+        uint32_t position;
+    };
+
+    struct QueueEntry {
+        double regret;
+        double best_cost;
+        bool opens_route;  // best option is a new route
+        uint32_t load;
+        uint32_t version;
+
+        // std::priority_queue pops the largest: highest regret, then insertions into existing routes before
+        // new routes, then the cheapest insertion. Among new routes though it's the most expensive first, so
+        // routes get seeded by the loads farthest from HQ (nearest first would leave the far ones to end up
+        // on their own), and the nearer loads get inserted around them. Then lowest load id. With k = 1 every
+        // regret is zero, so that makes it plain cheapest insertion with farthest first seeding.
+        bool operator<(const QueueEntry& other) const {
+            if (regret != other.regret) {
+                return regret < other.regret;
+            }
+            if (opens_route != other.opens_route) {
+                return opens_route;
+            }
+            if (best_cost != other.best_cost) {
+                return opens_route ? best_cost < other.best_cost : best_cost > other.best_cost;
+            }
+            return load > other.load;
+        }
+    };
+
+    const DistanceMatrix* _distance_matrix;
+    long double _max_minutes;
+    std::ofstream* _log;
+    ThreadPool* _pool;
+    std::chrono::steady_clock::time_point _deadline;
+
+    size_t _k;
+    std::vector<std::vector<uint32_t>> _routes;
+    std::vector<double> _route_minutes;
+    std::vector<uint8_t> _routed;
+
+    // Per unrouted load, its cheapest feasible insertion into every route it fits in, sorted by route. Emptied
+    // out once the load is routed.
+    std::vector<std::vector<Option>> _options;
+
+    std::vector<uint32_t> _unrouted;           // loads not routed yet, in no particular order
+    std::vector<uint32_t> _unrouted_index;     // per load, where it is in _unrouted
+
+    std::vector<double> _open_costs;     // per load, 500 plus the minutes of a route with just that load
+    std::vector<Option> _top;            // per load, its (up to) _k cheapest routes, cheapest first
+    std::vector<uint32_t> _top_sizes;
+    std::vector<uint32_t> _versions;     // per load, bumped every time its queue entry gets replaced
+    std::vector<QueueEntry> _entries;    // per load, the entry to push when it changed
+    std::vector<std::vector<uint32_t>> _changed;  // per refresh task, loads whose regret needs pushing again
+
+    // Recomputes route's cache entries for every unrouted load, and the top options and regrets they affect.
+    // Loads that need pushing again end up in _changed.
+    void refresh(size_t route);
+    void refresh_loads(size_t route, size_t first, size_t last, std::vector<uint32_t>& changed);
+
+    // Cheapest feasible position for load in route, returns its cost (infinity if none)
+    double cheapest_insertion(size_t route, uint32_t load, uint32_t& position) const;
+
+    // Rebuilds load's top options from all its cached options
+    void rescan_top(uint32_t load);
+
+    QueueEntry make_entry(uint32_t load) const;
+};
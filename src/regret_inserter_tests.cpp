@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+
+#include "evaluate_shared.h"
+#include "graph.h"
+#include "regret_inserter.h"
+#include "test_instances.h"
+#include "thread_pool.h"
+
+namespace {
+
+const long double kMaxMinutes = 12 * 60;
+
+std::ofstream test_log;  // never opened, so logging goes nowhere
+
+std::vector<std::vector<uint32_t>> to_routes(const Solution& solution) {
+    std::vector<std::vector<uint32_t>> routes;
+    for (size_t ii = 0; ii < solution.numRoutes(); ++ii) {
+        RouteView route = solution.route(ii);
+        routes.emplace_back(route.begin(), route.end());
+    }
+    return routes;
+}
+
+// Plain cheapest insertion, the slow obvious way: insert whichever load has the globally cheapest feasible
+// insertion, as long as that beats a route of its own. When no load has one, open a route with the load
+// farthest from HQ (the most expensive one to give its own route).
+std::vector<std::vector<uint32_t>> cheapest_insertion(const DistanceMatrix& matrix) {
+    size_t num_coordinates = matrix.size();
+    std::vector<std::vector<uint32_t>> routes;
+    std::vector<double> minutes;
+    std::vector<uint8_t> routed(num_coordinates, 0);
+    for (size_t num_routed = 0; num_routed + 1 < num_coordinates; ++num_routed) {
+        double best_cost = std::numeric_limits<double>::infinity();
+        uint32_t best_load = 0;
+        size_t best_route = 0;
+        size_t best_position = 0;
+        double farthest_cost = -1;
+        uint32_t farthest_load = 0;
+        for (uint32_t load = 1; load < num_coordinates; ++load) {
+            if (routed[load]) {
+                continue;
+            }
+            double open_cost = 500 + matrix[0][load] + matrix[load][0];
+            if (open_cost > farthest_cost) {
+                farthest_cost = open_cost;
+                farthest_load = load;
+            }
+            for (size_t route = 0; route < routes.size(); ++route) {
+                uint32_t previous = 0;
+                for (size_t position = 0; position <= routes[route].size(); ++position) {
+                    uint32_t next = (position == routes[route].size()) ? 0 : routes[route][position];
+                    double extra = matrix[previous][load] + matrix[load][next] - matrix[previous][next];
+                    if (extra < kMaxMinutes - minutes[route] && extra < open_cost && extra < best_cost) {
+                        best_cost = extra;
+                        best_load = load;
+                        best_route = route;
+                        best_position = position;
+                    }
+                    previous = next;
+                }
+            }
+        }
+        if (best_load != 0) {
+            routes[best_route].insert(routes[best_route].begin() + best_position, best_load);
+            minutes[best_route] += best_cost;
+            routed[best_load] = 1;
+        } else {
+            routes.push_back({farthest_load});
+            minutes.push_back(farthest_cost - 500);
+            routed[farthest_load] = 1;
+        }
+    }
+    return routes;
+}
+
+void expect_valid(const Graph& graph, const Solution& solution) {
+    EXPECT_EQ(EvaluateShared::validateSolutionSchedules(solution, graph.numCoordinates()), 0);
+    for (size_t ii = 0; ii < solution.numRoutes(); ++ii) {
+        EXPECT_LE(route_minutes(graph.getDistanceMatrix(), solution.route(ii)), kMaxMinutes);
+    }
+}
+
+}  // namespace
+
+TEST(RegretInserterTests, BuildsValidSolutions) {
+    for (uint32_t seed = 1; seed <= 4; ++seed) {
+        Graph graph({}, &test_log, kMaxMinutes);
+        graph.reset(random_coordinates(seed, 80, 125));
+        RegretInserter inserter(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+        for (size_t k = 1; k <= 4; ++k) {
+            Solution solution;
+            ASSERT_TRUE(inserter.solve(k, solution)) << "seed " << seed << " k " << k;
+            expect_valid(graph, solution);
+        }
+    }
+}
+
+TEST(RegretInserterTests, RegretOneIsCheapestInsertion) {
+    for (uint32_t seed = 5; seed <= 8; ++seed) {
+        Graph graph({}, &test_log, kMaxMinutes);
+        graph.reset(random_coordinates(seed, 60, 125));
+        RegretInserter inserter(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+        Solution solution;
+        ASSERT_TRUE(inserter.solve(1, solution));
+        EXPECT_EQ(to_routes(solution), cheapest_insertion(graph.getDistanceMatrix())) << "seed " << seed;
+    }
+}
+
+TEST(RegretInserterTests, ThreadPoolGivesTheSameSolution) {
+    // enough loads that refreshes get split across the pool
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(9, 1200));
+    RegretInserter serial(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+    Solution serial_solution;
+    ASSERT_TRUE(serial.solve(2, serial_solution));
+    expect_valid(graph, serial_solution);
+
+    ThreadPool pool(4);
+    RegretInserter parallel(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+    parallel.set_thread_pool(&pool);
+    Solution parallel_solution;
+    ASSERT_TRUE(parallel.solve(2, parallel_solution));
+    EXPECT_EQ(to_routes(parallel_solution), to_routes(serial_solution));
+}
+
+TEST(RegretInserterTests, GivesUpPastTheDeadline) {
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(10, 200));
+    RegretInserter inserter(&graph.getDistanceMatrix(), kMaxMinutes, &test_log);
+    inserter.set_deadline(std::chrono::steady_clock::now());
+    Solution solution;
+    solution.begin_route();
+    solution.push_load(1);
+    EXPECT_FALSE(inserter.solve(2, solution));
+    EXPECT_EQ(solution.numRoutes(), 1u);
+}
@@ -0,0 +1,234 @@
+#include "resequencer.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Orders that differ by less than this are treated as the same length, so rounding noise never counts as
+// an improvement
+constexpr double kEpsilon = 1e-9;
+
+}  // namespace
+
+Resequencer::Resequencer(size_t max_exact_loads)
+: _distance_matrix(nullptr)
+, _max_exact_loads(std::min(max_exact_loads, kMaxExactLoads))
+, _pool(nullptr)
+, _scratch(1)
+, _cache_hits(0)
+, _cache_misses(0) {}
+
+void Resequencer::reset(const DistanceMatrix* distance_matrix) {
+    _distance_matrix = distance_matrix;
+    _cache.clear();
+    _cache_hits = 0;
+    _cache_misses = 0;
+}
+
+void Resequencer::set_thread_pool(ThreadPool* pool) {
+    _pool = pool;
+    _scratch.resize(pool ? std::max<size_t>(1, pool->size()) : 1);
+}
+
+size_t Resequencer::LoadSetHash::operator()(const std::vector<uint32_t>& loads) const {
+    // FNV-1a over the (sorted) load ids
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t load_id : loads) {
+        hash ^= load_id;
+        hash *= 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+}
+
+double Resequencer::route_minutes(const uint32_t* loads, size_t length) const {
+    const DistanceMatrix& matrix = *_distance_matrix;
+    double minutes = 0;
+    uint32_t current_load = 0;
+    for (size_t position = 0; position < length; ++position) {
+        minutes += matrix[current_load][loads[position]];
+        current_load = loads[position];
+    }
+    return minutes + matrix[current_load][0];
+}
+
+long double Resequencer::optimize(Solution& solution) {
+    long double saved = 0;
+
+    // Cache hits get handled right away, misses get collected up to be solved (maybe in parallel) below
+    _misses.clear();
+    for (size_t route_index = 0; route_index < solution.numRoutes(); ++route_index) {
+        RouteView route = solution.route(route_index);
+        if (route.size() < 2) {
+            continue;
+        }
+        _key.assign(route.begin(), route.end());
+        std::sort(_key.begin(), _key.end());
+        auto it = _cache.find(_key);
+        if (it == _cache.end()) {
+            _misses.push_back(route_index);
+            continue;
+        }
+        ++_cache_hits;
+        CachedRoute& cached = it->second;
+        double current_minutes = route_minutes(route.loads, route.size());
+        if (cached.minutes < current_minutes - kEpsilon) {
+            std::copy(cached.order.begin(), cached.order.end(), solution.mutable_route(route_index));
+            saved += current_minutes - cached.minutes;
+        } else if (current_minutes < cached.minutes - kEpsilon) {
+            // or-opt only finds a local optimum, and this order happens to beat it
+            cached.order.assign(route.begin(), route.end());
+            cached.minutes = current_minutes;
+        }
+    }
+    if (_misses.empty()) {
+        return saved;
+    }
+    _cache_misses += _misses.size();
+
+    _miss_orders.resize(_misses.size());
+    auto solve_miss = [&](size_t worker_index, size_t miss_index) {
+        RouteView route = solution.route(_misses[miss_index]);
+        std::vector<uint32_t>& order = _miss_orders[miss_index];
+        order.assign(route.begin(), route.end());
+        if (order.size() <= _max_exact_loads) {
+            held_karp(order, _scratch[worker_index]);
+        } else {
+            or_opt(order);
+        }
+    };
+    if (_pool && _misses.size() > 1) {
+        _pool->run_all(_misses.size(), solve_miss);
+    } else {
+        for (size_t miss_index = 0; miss_index < _misses.size(); ++miss_index) {
+            solve_miss(0, miss_index);
+        }
+    }
+
+    for (size_t miss_index = 0; miss_index < _misses.size(); ++miss_index) {
+        size_t route_index = _misses[miss_index];
+        RouteView route = solution.route(route_index);
+        std::vector<uint32_t>& order = _miss_orders[miss_index];
+        double current_minutes = route_minutes(route.loads, route.size());
+        double best_minutes = route_minutes(order.data(), order.size());
+        if (best_minutes < current_minutes - kEpsilon) {
+            std::copy(order.begin(), order.end(), solution.mutable_route(route_index));
+            saved += current_minutes - best_minutes;
+        } else {
+            order.assign(route.begin(), route.end());
+            best_minutes = current_minutes;
+        }
+
+        if (_cache.size() >= kMaxCacheEntries) {
+            _cache.clear();
+        }
+        _key.assign(order.begin(), order.end());
+        std::sort(_key.begin(), _key.end());
+        _cache.emplace(_key, CachedRoute{order, best_minutes});
+    }
+    return saved;
+}
+
+void Resequencer::held_karp(std::vector<uint32_t>& order, Scratch& scratch) const {
+    const DistanceMatrix& matrix = *_distance_matrix;
+    const double kInfinity = std::numeric_limits<double>::infinity();
+    size_t n = order.size();
+    if (n < 2) {
+        return;
+    }
+    size_t num_masks = size_t(1) << n;
+    uint32_t full_mask = static_cast<uint32_t>(num_masks - 1);
+
+    scratch.minutes.assign(num_masks * n, kInfinity);
+    scratch.previous.resize(num_masks * n);
+    for (size_t first = 0; first < n; ++first) {
+        scratch.minutes[(size_t(1) << first) * n + first] = matrix[0][order[first]];
+    }
+
+    // Every mask only extends into bigger masks, so plain increasing order visits each one after all its subsets
+    for (uint32_t mask = 1; mask < full_mask; ++mask) {
+        for (size_t last = 0; last < n; ++last) {
+            double minutes = scratch.minutes[mask * n + last];
+            if (minutes == kInfinity) {
+                continue;
+            }
+            const double* from_last = matrix[order[last]];
+            for (size_t next = 0; next < n; ++next) {
+                if (mask & (1u << next)) {
+                    continue;
+                }
+                size_t cell = (mask | (1u << next)) * n + next;
+                double candidate = minutes + from_last[order[next]];
+                if (candidate < scratch.minutes[cell]) {
+                    scratch.minutes[cell] = candidate;
+                    scratch.previous[cell] = static_cast<uint8_t>(last);
+                }
+            }
+        }
+    }
+
+    size_t best_last = 0;
+    double best_minutes = kInfinity;
+    for (size_t last = 0; last < n; ++last) {
+        double minutes = scratch.minutes[full_mask * n + last] + matrix[order[last]][0];
+        if (minutes < best_minutes) {
+            best_minutes = minutes;
+            best_last = last;
+        }
+    }
+
+    // Walk the table backwards from the last load
+    std::vector<uint32_t> best_order(n);
+    uint32_t mask = full_mask;
+    size_t last = best_last;
+    for (size_t position = n; position-- > 0;) {
+        best_order[position] = order[last];
+        size_t previous = scratch.previous[mask * n + last];
+        mask &= ~(1u << last);
+        last = previous;
+    }
+    order.swap(best_order);
+}
+
+void Resequencer::or_opt(std::vector<uint32_t>& order) const {
+    const DistanceMatrix& matrix = *_distance_matrix;
+    const size_t kMaxSegmentLength = 3;
+    size_t n = order.size();
+    std::vector<uint32_t> rest;
+    rest.reserve(n);
+
+    bool improved = true;
+    while (improved) {
+        improved = false;
+        for (size_t length = 1; length <= kMaxSegmentLength && length < n && !improved; ++length) {
+            for (size_t start = 0; start + length <= n && !improved; ++start) {
+                uint32_t first = order[start];
+                uint32_t last = order[start + length - 1];
+                uint32_t before = (start == 0) ? 0 : order[start - 1];
+                uint32_t after = (start + length == n) ? 0 : order[start + length];
+                double removal_saves = matrix[before][first] + matrix[last][after] - matrix[before][after];
+
+                // Everything but the segment, with the segment going back in between rest[spot-1] and rest[spot]
+                rest.clear();
+                rest.insert(rest.end(), order.begin(), order.begin() + start);
+                rest.insert(rest.end(), order.begin() + start + length, order.end());
+                for (size_t spot = 0; spot <= rest.size(); ++spot) {
+                    if (spot == start) {
+                        // that's where it came from
+                        continue;
+                    }
+                    uint32_t from = (spot == 0) ? 0 : rest[spot - 1];
+                    uint32_t to = (spot == rest.size()) ? 0 : rest[spot];
+                    double insertion_costs = matrix[from][first] + matrix[last][to] - matrix[from][to];
+                    if (insertion_costs < removal_saves - kEpsilon) {
+                        std::vector<uint32_t> moved(order.begin() + start, order.begin() + start + length);
+                        rest.insert(rest.begin() + spot, moved.begin(), moved.end());
+                        order.swap(rest);
+                        improved = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
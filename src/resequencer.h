@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "distance_matrix.h"
+#include "solution.h"
+#include "thread_pool.h"
+
+// Post-pass that keeps every route's set of loads but reorders them to cut down deadhead minutes. The planner
+// visits loads in whatever order the Scheme walk happened to pick, which often isn't the best order even
+// when the split of loads between drivers is good.
+//
+// Routes of up to max_exact_loads loads get the optimal order from a Held-Karp DP over the (asymmetric)
+// distance matrix, starting and ending at HQ. Longer routes get or-opt instead: moving runs of 1 to 3
+// consecutive loads elsewhere in the route for as long as that helps.
+//
+// The best order found for each set of loads is cached, so candidates that share routes (which lots of them
+// do) only pay for each route once. Reordering never makes a route longer, so it can't break max_minutes.
+class Resequencer {
+public:
+    static constexpr size_t kDefaultMaxExactLoads = 12;
+
+    // The Held-Karp table is (2^n * n) doubles, so this is as far as it's allowed to go
+    static constexpr size_t kMaxExactLoads = 16;
+
+    // Once the cache holds this many routes it starts over, to keep memory bounded
+    static constexpr size_t kMaxCacheEntries = 1 << 18;
+
+    explicit Resequencer(size_t max_exact_loads = kDefaultMaxExactLoads);
+
+    // Starts over for a different distance matrix, forgetting everything cached
+    void reset(const DistanceMatrix* distance_matrix);
+
+    // Routes that miss the cache get solved in parallel on pool. The pool must not be the one running the
+    // caller, see ThreadPool::run_all(). nullptr (the default) solves them one after another.
+    void set_thread_pool(ThreadPool* pool);
+
+    // Reorders the loads within each route of solution. Returns the total minutes saved.
+    long double optimize(Solution& solution);
+
+    size_t cache_hits() const {
+        return _cache_hits;
+    }
+
+    size_t cache_misses() const {
+        return _cache_misses;
+    }
+
+private:
+    struct CachedRoute {
+        std::vector<uint32_t> order;
+        double minutes;
+    };
+
+    struct LoadSetHash {
+        size_t operator()(const std::vector<uint32_t>& loads) const;
+    };
+
+    // Held-Karp tables, one set per worker so parallel solves don't share them
+    struct Scratch {
+        std::vector<double> minutes;    // [mask * n + last], best minutes from HQ through mask ending at last
+        std::vector<uint8_t> previous;  // [mask * n + last], the load before last on that best path
+    };
+
+    const DistanceMatrix* _distance_matrix;
+    size_t _max_exact_loads;
+    ThreadPool* _pool;
+    std::vector<Scratch> _scratch;
+    std::unordered_map<std::vector<uint32_t>, CachedRoute, LoadSetHash> _cache;
+    size_t _cache_hits;
+    size_t _cache_misses;
+
+    // Per optimize() call, kept around to avoid reallocating
+    std::vector<uint32_t> _key;
+    std::vector<size_t> _misses;
+    std::vector<std::vector<uint32_t>> _miss_orders;
+
+    double route_minutes(const uint32_t* loads, size_t length) const;
+
+    // Rewrites order (a whole route) into its optimal order
+    void held_karp(std::vector<uint32_t>& order, Scratch& scratch) const;
+
+    // Improves order (a whole route) by or-opt moves until none help
+    void or_opt(std::vector<uint32_t>& order) const;
+};
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+#include "graph.h"
+#include "resequencer.h"
+#include "test_instances.h"
+#include "thread_pool.h"
+
+namespace {
+
+const long double kMaxMinutes = 12 * 60;
+
+std::ofstream test_log;  // never opened, so logging goes nowhere
+
+std::vector<std::vector<uint32_t>> to_routes(const Solution& solution) {
+    std::vector<std::vector<uint32_t>> routes;
+    for (size_t ii = 0; ii < solution.numRoutes(); ++ii) {
+        RouteView route = solution.route(ii);
+        routes.emplace_back(route.begin(), route.end());
+    }
+    return routes;
+}
+
+// Loads 1 through num_loads dealt out in a random order into routes of route_length (the last one maybe shorter)
+Solution random_solution(uint32_t seed, size_t num_loads, size_t route_length) {
+    std::vector<uint32_t> loads(num_loads);
+    std::iota(loads.begin(), loads.end(), 1);
+    std::mt19937 gen(seed);
+    std::shuffle(loads.begin(), loads.end(), gen);
+    Solution solution;
+    solution.clear();
+    for (size_t ii = 0; ii < num_loads; ++ii) {
+        if (ii % route_length == 0) {
+            solution.begin_route();
+        }
+        solution.push_load(loads[ii]);
+    }
+    return solution;
+}
+
+double best_order_minutes(const DistanceMatrix& matrix, std::vector<uint32_t> route) {
+    std::sort(route.begin(), route.end());
+    double best = std::numeric_limits<double>::infinity();
+    do {
+        best = std::min(best, route_minutes(matrix, route));
+    } while (std::next_permutation(route.begin(), route.end()));
+    return best;
+}
+
+// Each optimized route has the same loads as before, and is no longer than it was
+void expect_same_loads_no_longer(const DistanceMatrix& matrix, const std::vector<std::vector<uint32_t>>& before, const std::vector<std::vector<uint32_t>>& after) {
+    ASSERT_EQ(before.size(), after.size());
+    for (size_t ii = 0; ii < before.size(); ++ii) {
+        EXPECT_TRUE(std::is_permutation(before[ii].begin(), before[ii].end(), after[ii].begin(), after[ii].end()));
+        EXPECT_LE(route_minutes(matrix, after[ii]), route_minutes(matrix, before[ii]) + 1e-9);
+    }
+}
+
+}  // namespace
+
+TEST(ResequencerTests, HeldKarpFindsTheBestOrder) {
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(11, 42));
+    Solution solution = random_solution(11, 42, 7);
+    std::vector<std::vector<uint32_t>> before = to_routes(solution);
+
+    Resequencer resequencer;
+    resequencer.reset(&graph.getDistanceMatrix());
+    long double saved = resequencer.optimize(solution);
+    std::vector<std::vector<uint32_t>> after = to_routes(solution);
+    expect_same_loads_no_longer(graph.getDistanceMatrix(), before, after);
+
+    long double expected_saved = 0;
+    for (size_t ii = 0; ii < before.size(); ++ii) {
+        double best = best_order_minutes(graph.getDistanceMatrix(), before[ii]);
+        EXPECT_NEAR(route_minutes(graph.getDistanceMatrix(), after[ii]), best, 1e-6) << "route " << ii;
+        expected_saved += route_minutes(graph.getDistanceMatrix(), before[ii]) - best;
+    }
+    EXPECT_NEAR(static_cast<double>(saved), static_cast<double>(expected_saved), 1e-6);
+}
+
+TEST(ResequencerTests, OrOptNeverMakesRoutesLonger) {
+    // past max_exact_loads, so every route goes through or-opt
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(12, 60));
+    Solution solution = random_solution(12, 60, 15);
+    std::vector<std::vector<uint32_t>> before = to_routes(solution);
+
+    Resequencer resequencer(4);
+    resequencer.reset(&graph.getDistanceMatrix());
+    EXPECT_GE(resequencer.optimize(solution), 0);
+    expect_same_loads_no_longer(graph.getDistanceMatrix(), before, to_routes(solution));
+}
+
+TEST(ResequencerTests, CacheHitsMatchMisses) {
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(13, 40));
+    Solution first = random_solution(13, 40, 8);
+
+    Resequencer resequencer;
+    resequencer.reset(&graph.getDistanceMatrix());
+    Solution missed = first;
+    resequencer.optimize(missed);
+    EXPECT_EQ(resequencer.cache_misses(), first.numRoutes());
+    EXPECT_EQ(resequencer.cache_hits(), 0u);
+
+    // the same sets of loads in a different order within each route all come out of the cache, and the same
+    Solution shuffled;
+    shuffled.clear();
+    std::mt19937 gen(13);
+    for (std::vector<uint32_t> route : to_routes(first)) {
+        std::shuffle(route.begin(), route.end(), gen);
+        shuffled.begin_route();
+        for (uint32_t load : route) {
+            shuffled.push_load(load);
+        }
+    }
+    resequencer.optimize(shuffled);
+    EXPECT_EQ(resequencer.cache_misses(), first.numRoutes());
+    EXPECT_EQ(resequencer.cache_hits(), first.numRoutes());
+    EXPECT_EQ(to_routes(shuffled), to_routes(missed));
+
+    // reset() forgets everything
+    resequencer.reset(&graph.getDistanceMatrix());
+    Solution again = first;
+    resequencer.optimize(again);
+    EXPECT_EQ(resequencer.cache_misses(), first.numRoutes());
+    EXPECT_EQ(resequencer.cache_hits(), 0u);
+    EXPECT_EQ(to_routes(again), to_routes(missed));
+}
+
+TEST(ResequencerTests, ThreadPoolGivesTheSameOrders) {
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(14, 80));
+    Solution serial = random_solution(14, 80, 10);
+    Solution parallel = serial;
+
+    Resequencer serial_resequencer;
+    serial_resequencer.reset(&graph.getDistanceMatrix());
+    serial_resequencer.optimize(serial);
+
+    ThreadPool pool(4);
+    Resequencer parallel_resequencer;
+    parallel_resequencer.reset(&graph.getDistanceMatrix());
+    parallel_resequencer.set_thread_pool(&pool);
+    parallel_resequencer.optimize(parallel);
+    EXPECT_EQ(to_routes(parallel), to_routes(serial));
+}
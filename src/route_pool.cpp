@@ -0,0 +1,605 @@
+#include "route_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ROUTE_POOL_X86 1
+#include <immintrin.h>
+#else
+#define ROUTE_POOL_X86 0
+#endif
+
+namespace {
+
+// Costs that differ by less than this are treated as equal, so rounding noise never counts as an improvement
+constexpr double kEpsilon = 1e-9;
+
+// However big the instance, the byte budget never shrinks the pool below this many routes
+constexpr size_t kMinCapacity = 1024;
+
+// When refilling freed loads, this many pooled routes through a load get tried before settling for a single
+// load route
+constexpr size_t kMaxRefillTries = 256;
+
+// Operations on whole bitsets of num_words 64 bit words
+struct BitsetOps {
+    bool (*intersects)(const uint64_t* a, const uint64_t* b, size_t num_words);
+    bool (*is_subset)(const uint64_t* a, const uint64_t* b, size_t num_words);  // every bit of a is in b
+    size_t (*popcount)(const uint64_t* a, size_t num_words);
+};
+
+bool intersects_scalar(const uint64_t* a, const uint64_t* b, size_t num_words) {
+    for (size_t word = 0; word < num_words; ++word) {
+        if (a[word] & b[word]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool is_subset_scalar(const uint64_t* a, const uint64_t* b, size_t num_words) {
+    for (size_t word = 0; word < num_words; ++word) {
+        if (a[word] & ~b[word]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t popcount_scalar(const uint64_t* a, size_t num_words) {
+    size_t count = 0;
+    for (size_t word = 0; word < num_words; ++word) {
+        count += __builtin_popcountll(a[word]);
+    }
+    return count;
+}
+
+#if ROUTE_POOL_X86
+
+// vptest does the AND and the all zero check for 4 words at once
+__attribute__((target("avx2")))
+bool intersects_avx2(const uint64_t* a, const uint64_t* b, size_t num_words) {
+    size_t word = 0;
+    for (; word + 4 <= num_words; word += 4) {
+        __m256i a_words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + word));
+        __m256i b_words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + word));
+        if (!_mm256_testz_si256(a_words, b_words)) {
+            return true;
+        }
+    }
+    return intersects_scalar(a + word, b + word, num_words - word);
+}
+
+__attribute__((target("avx2")))
+bool is_subset_avx2(const uint64_t* a, const uint64_t* b, size_t num_words) {
+    size_t word = 0;
+    for (; word + 4 <= num_words; word += 4) {
+        __m256i a_words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + word));
+        __m256i b_words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + word));
+        // testc checks (~b & a) == 0
+        if (!_mm256_testc_si256(b_words, a_words)) {
+            return false;
+        }
+    }
+    return is_subset_scalar(a + word, b + word, num_words - word);
+}
+
+// AVX2 has no vector popcount, but every AVX2 CPU has the popcnt instruction, which the generic build can't
+// assume. Four counts in flight so they don't wait on each other.
+__attribute__((target("avx2,popcnt")))
+size_t popcount_avx2(const uint64_t* a, size_t num_words) {
+    size_t counts[4] = {0, 0, 0, 0};
+    size_t word = 0;
+    for (; word + 4 <= num_words; word += 4) {
+        counts[0] += __builtin_popcountll(a[word]);
+        counts[1] += __builtin_popcountll(a[word + 1]);
+        counts[2] += __builtin_popcountll(a[word + 2]);
+        counts[3] += __builtin_popcountll(a[word + 3]);
+    }
+    for (; word < num_words; ++word) {
+        counts[0] += __builtin_popcountll(a[word]);
+    }
+    return counts[0] + counts[1] + counts[2] + counts[3];
+}
+
+#endif
+
+BitsetOps pick_ops() {
+#if ROUTE_POOL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        return BitsetOps{intersects_avx2, is_subset_avx2, popcount_avx2};
+    }
+#endif
+    return BitsetOps{intersects_scalar, is_subset_scalar, popcount_scalar};
+}
+
+const BitsetOps& bitset_ops() {
+    static const BitsetOps ops = pick_ops();
+    return ops;
+}
+
+uint64_t hash_bits(const uint64_t* bits, size_t num_words) {
+    // splitmix64 finalizer over each word, chained
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+    for (size_t word = 0; word < num_words; ++word) {
+        uint64_t mixed = hash ^ bits[word];
+        mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ull;
+        mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBull;
+        hash = mixed ^ (mixed >> 31);
+    }
+    return hash;
+}
+
+void set_bit(uint64_t* bits, size_t index) {
+    bits[index / 64] |= uint64_t(1) << (index % 64);
+}
+
+}  // namespace
+
+RoutePool::RoutePool(std::ofstream* log, size_t max_bytes)
+: _log(log)
+, _max_bytes(max_bytes)
+, _distance_matrix(nullptr)
+, _num_words(0)
+, _capacity(0)
+, _version(0)
+, _generation(0)
+, _stopping(false)
+, _improvement_cost(std::numeric_limits<double>::infinity())
+, _has_improvement(false) {}
+
+RoutePool::~RoutePool() {
+    stop_background();
+}
+
+void RoutePool::reset(const DistanceMatrix* distance_matrix) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _distance_matrix = distance_matrix;
+    _num_words = (distance_matrix->size() + 63) / 64;
+
+    // Roughly what a route costs besides its bitset: its cost, its loads, an offset and an index entry
+    size_t bytes_per_route = _num_words * sizeof(uint64_t) + 64;
+    _capacity = std::max(kMinCapacity, _max_bytes / bytes_per_route);
+
+    _bits.clear();
+    _costs.clear();
+    _routes.clear();
+    _index.clear();
+    _route_bits.assign(_num_words, 0);
+    _replaced.clear();
+    ++_version;
+    ++_generation;
+
+    std::lock_guard<std::mutex> background_lock(_background_mutex);
+    _improvement.clear();
+    _improvement_cost = std::numeric_limits<double>::infinity();
+    _has_improvement = false;
+}
+
+double RoutePool::route_minutes(const uint32_t* loads, size_t length) const {
+    const DistanceMatrix& matrix = *_distance_matrix;
+    double minutes = 0;
+    uint32_t current_load = 0;
+    for (size_t position = 0; position < length; ++position) {
+        minutes += matrix[current_load][loads[position]];
+        current_load = loads[position];
+    }
+    return minutes + matrix[current_load][0];
+}
+
+size_t RoutePool::size() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _costs.size();
+}
+
+void RoutePool::add(const Solution& solution) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (size_t route_index = 0; route_index < solution.numRoutes(); ++route_index) {
+        RouteView route = solution.route(route_index);
+        if (route.empty()) {
+            continue;
+        }
+        std::fill(_route_bits.begin(), _route_bits.end(), 0);
+        for (uint32_t load_id : route) {
+            set_bit(_route_bits.data(), load_id);
+        }
+        uint64_t hash = hash_bits(_route_bits.data(), _num_words);
+        double cost = 500 + route_minutes(route.loads, route.size());
+
+        bool seen = false;
+        auto range = _index.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            uint32_t pooled = it->second;
+            if (std::memcmp(&_bits[pooled * _num_words], _route_bits.data(), _num_words * sizeof(uint64_t)) != 0) {
+                continue;
+            }
+            seen = true;
+            if (cost < _costs[pooled] - kEpsilon) {
+                // Same loads, so same length, so the better order fits right where the old one was
+                std::copy(route.begin(), route.end(), _routes.mutable_route(pooled));
+                _costs[pooled] = cost;
+                _replaced.push_back(pooled);
+                ++_version;
+            }
+            break;
+        }
+        if (seen) {
+            continue;
+        }
+
+        if (_costs.size() >= _capacity) {
+            evict();
+        }
+        _index.emplace(hash, static_cast<uint32_t>(_costs.size()));
+        _bits.insert(_bits.end(), _route_bits.begin(), _route_bits.end());
+        _costs.push_back(cost);
+        _routes.begin_route();
+        for (uint32_t load_id : route) {
+            _routes.push_load(load_id);
+        }
+        ++_version;
+    }
+}
+
+void RoutePool::evict() {
+    // Cost per load is what the greedy cover goes by, so the routes it'd pick last are the ones to lose
+    std::vector<uint32_t> order(_costs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return _costs[a] / _routes.route(a).size() < _costs[b] / _routes.route(b).size();
+    });
+    order.resize(order.size() / 2);
+    std::sort(order.begin(), order.end());
+
+    std::vector<uint64_t> bits;
+    std::vector<double> costs;
+    Solution routes;
+    bits.reserve(order.size() * _num_words);
+    costs.reserve(order.size());
+    for (uint32_t kept : order) {
+        bits.insert(bits.end(), _bits.begin() + kept * _num_words, _bits.begin() + (kept + 1) * _num_words);
+        costs.push_back(_costs[kept]);
+        routes.begin_route();
+        for (uint32_t load_id : _routes.route(kept)) {
+            routes.push_load(load_id);
+        }
+    }
+#if LOGGING
+    *_log << "Route pool full at " << _costs.size() << " routes, kept the best " << costs.size() << std::endl;
+#endif
+    _bits.swap(bits);
+    _costs.swap(costs);
+    std::swap(_routes, routes);
+    rebuild_index();
+    _replaced.clear();
+    ++_version;
+    ++_generation;
+}
+
+void RoutePool::rebuild_index() {
+    _index.clear();
+    for (size_t pooled = 0; pooled < _costs.size(); ++pooled) {
+        _index.emplace(hash_bits(&_bits[pooled * _num_words], _num_words), static_cast<uint32_t>(pooled));
+    }
+}
+
+uint64_t RoutePool::take_snapshot(Snapshot& snapshot) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (snapshot.generation != _generation) {
+        // routes got renumbered, nothing already in snapshot can be trusted
+        snapshot.num_words = _num_words;
+        snapshot.generation = _generation;
+        snapshot.bits = _bits;
+        snapshot.costs = _costs;
+        snapshot.routes = _routes;
+        snapshot.num_replaced = _replaced.size();
+        return _version;
+    }
+
+    // Shorter orders for routes snapshot already has
+    size_t num_copied = snapshot.costs.size();
+    for (size_t replaced = snapshot.num_replaced; replaced < _replaced.size(); ++replaced) {
+        uint32_t pooled = _replaced[replaced];
+        if (pooled < num_copied) {
+            RouteView route = _routes.route(pooled);
+            std::copy(route.begin(), route.end(), snapshot.routes.mutable_route(pooled));
+            snapshot.costs[pooled] = _costs[pooled];
+        }
+    }
+    snapshot.num_replaced = _replaced.size();
+
+    // and the routes added after them
+    snapshot.bits.insert(snapshot.bits.end(), _bits.begin() + num_copied * _num_words, _bits.end());
+    snapshot.costs.insert(snapshot.costs.end(), _costs.begin() + num_copied, _costs.end());
+    for (size_t pooled = num_copied; pooled < _costs.size(); ++pooled) {
+        snapshot.routes.begin_route();
+        for (uint32_t load_id : _routes.route(pooled)) {
+            snapshot.routes.push_load(load_id);
+        }
+    }
+    return _version;
+}
+
+bool RoutePool::recombine(Solution& solution, std::chrono::steady_clock::time_point deadline) {
+    Snapshot snapshot;
+    take_snapshot(snapshot);
+    if (snapshot.costs.empty()) {
+        return false;
+    }
+    solve(snapshot, solution, deadline);
+    return true;
+}
+
+double RoutePool::solve(const Snapshot& snapshot, Solution& solution, std::chrono::steady_clock::time_point deadline) const {
+    const BitsetOps& ops = bitset_ops();
+    const DistanceMatrix& matrix = *_distance_matrix;
+    size_t num_words = snapshot.num_words;
+    size_t num_pooled = snapshot.costs.size();
+    size_t num_coordinates = matrix.size();
+
+    // Every load also gets its own single load route, numbered num_pooled + load id, so whatever the pooled
+    // routes leave uncovered can always be covered. Those never get a bitset of their own, at one bit each
+    // they'd be all waste.
+    auto cost_of = [&](size_t route_id) {
+        if (route_id < num_pooled) {
+            return snapshot.costs[route_id];
+        }
+        size_t load_id = route_id - num_pooled;
+        return 500 + matrix[0][load_id] + matrix[load_id][0];
+    };
+    auto bits_of = [&](size_t route_id) {
+        return &snapshot.bits[route_id * num_words];
+    };
+
+    // Most cost effective routes first, and for each load, the pooled routes through it in that same order
+    std::vector<uint32_t> order(num_pooled);
+    std::vector<double> cost_per_load(num_pooled);
+    for (size_t pooled = 0; pooled < num_pooled; ++pooled) {
+        order[pooled] = static_cast<uint32_t>(pooled);
+        cost_per_load[pooled] = snapshot.costs[pooled] / ops.popcount(bits_of(pooled), num_words);
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return cost_per_load[a] < cost_per_load[b];
+    });
+    std::vector<std::vector<uint32_t>> routes_through(num_coordinates);
+    for (uint32_t pooled : order) {
+        for (uint32_t load_id : snapshot.routes.route(pooled)) {
+            routes_through[load_id].push_back(pooled);
+        }
+    }
+
+    // Greedy cover
+    std::vector<size_t> owner(num_coordinates, 0);  // route covering each load
+    std::vector<uint8_t> chosen(num_pooled, 0);
+    std::vector<uint64_t> covered(num_words, 0);
+    double total_cost = 0;
+    for (uint32_t pooled : order) {
+        const uint64_t* bits = bits_of(pooled);
+        if (ops.intersects(bits, covered.data(), num_words)) {
+            continue;
+        }
+        chosen[pooled] = 1;
+        total_cost += snapshot.costs[pooled];
+        for (size_t word = 0; word < num_words; ++word) {
+            covered[word] |= bits[word];
+        }
+        for (uint32_t load_id : snapshot.routes.route(pooled)) {
+            owner[load_id] = pooled;
+        }
+    }
+    for (size_t load_id = 1; load_id < num_coordinates; ++load_id) {
+        if (!(covered[load_id / 64] & (uint64_t(1) << (load_id % 64)))) {
+            owner[load_id] = num_pooled + load_id;
+            total_cost += cost_of(num_pooled + load_id);
+        }
+    }
+#if LOGGING
+    double greedy_cost = total_cost;
+#endif
+
+    // Local branching: force in a route that isn't chosen, drop the chosen routes it overlaps, and refill
+    // whatever loads those covered that it doesn't, greedily from routes that fit entirely inside the gap
+    std::vector<size_t> conflicts;
+    std::vector<size_t> refill;
+    std::vector<uint64_t> freed(num_words);
+    std::vector<uint32_t> conflict_stamp(num_pooled + num_coordinates, 0);
+    uint32_t stamp = 0;
+    size_t num_moves = 0;
+    bool improved = true;
+    bool out_of_time = false;
+    while (improved && !out_of_time) {
+        improved = false;
+        for (size_t rank = 0; rank < order.size(); ++rank) {
+            if ((rank & 255) == 0 && std::chrono::steady_clock::now() >= deadline) {
+                out_of_time = true;
+                break;
+            }
+            uint32_t forced = order[rank];
+            if (chosen[forced]) {
+                continue;
+            }
+            RouteView forced_route = snapshot.routes.route(forced);
+
+            ++stamp;
+            conflicts.clear();
+            double delta = snapshot.costs[forced];
+            for (uint32_t load_id : forced_route) {
+                size_t conflict = owner[load_id];
+                if (conflict_stamp[conflict] != stamp) {
+                    conflict_stamp[conflict] = stamp;
+                    conflicts.push_back(conflict);
+                    delta -= cost_of(conflict);
+                }
+            }
+            if (delta >= -kEpsilon) {
+                // refilling only ever adds to that
+                continue;
+            }
+
+            std::fill(freed.begin(), freed.end(), 0);
+            for (size_t conflict : conflicts) {
+                if (conflict < num_pooled) {
+                    const uint64_t* bits = bits_of(conflict);
+                    for (size_t word = 0; word < num_words; ++word) {
+                        freed[word] |= bits[word];
+                    }
+                } else {
+                    set_bit(freed.data(), conflict - num_pooled);
+                }
+            }
+            const uint64_t* forced_bits = bits_of(forced);
+            for (size_t word = 0; word < num_words; ++word) {
+                freed[word] &= ~forced_bits[word];
+            }
+
+            refill.clear();
+            for (size_t word = 0; word < num_words && delta < -kEpsilon; ++word) {
+                while (freed[word] && delta < -kEpsilon) {
+                    size_t load_id = word * 64 + __builtin_ctzll(freed[word]);
+                    size_t pick = num_pooled + load_id;
+                    const std::vector<uint32_t>& candidates = routes_through[load_id];
+                    size_t tries = std::min(candidates.size(), kMaxRefillTries);
+                    for (size_t ii = 0; ii < tries; ++ii) {
+                        if (ops.is_subset(bits_of(candidates[ii]), freed.data(), num_words)) {
+                            pick = candidates[ii];
+                            break;
+                        }
+                    }
+                    delta += cost_of(pick);
+                    refill.push_back(pick);
+                    if (pick < num_pooled) {
+                        const uint64_t* bits = bits_of(pick);
+                        for (size_t other = word; other < num_words; ++other) {
+                            freed[other] &= ~bits[other];
+                        }
+                    } else {
+                        freed[word] &= freed[word] - 1;
+                    }
+                }
+            }
+            if (delta >= -kEpsilon) {
+                continue;
+            }
+
+            // Keep it. Routes taking over loads overwrite their owners, so the conflicts just need unchoosing.
+            for (size_t conflict : conflicts) {
+                if (conflict < num_pooled) {
+                    chosen[conflict] = 0;
+                }
+            }
+            refill.push_back(forced);
+            for (size_t route_id : refill) {
+                if (route_id < num_pooled) {
+                    chosen[route_id] = 1;
+                    for (uint32_t load_id : snapshot.routes.route(route_id)) {
+                        owner[load_id] = route_id;
+                    }
+                } else {
+                    owner[route_id - num_pooled] = route_id;
+                }
+            }
+            total_cost += delta;
+            ++num_moves;
+            improved = true;
+        }
+    }
+
+    solution.clear();
+    for (size_t pooled = 0; pooled < num_pooled; ++pooled) {
+        if (!chosen[pooled]) {
+            continue;
+        }
+        solution.begin_route();
+        for (uint32_t load_id : snapshot.routes.route(pooled)) {
+            solution.push_load(load_id);
+        }
+    }
+    for (size_t load_id = 1; load_id < num_coordinates; ++load_id) {
+        if (owner[load_id] == num_pooled + load_id) {
+            solution.begin_route();
+            solution.push_load(load_id);
+        }
+    }
+
+#if LOGGING
+    *_log << "Recombined " << num_pooled << " pooled routes, greedy cost = " << greedy_cost << ", after " << num_moves
+          << " local branching moves = " << total_cost << (out_of_time ? " (out of time)" : "") << std::endl;
+#else
+    (void)num_moves;
+#endif
+    return total_cost;
+}
+
+void RoutePool::start_background(std::chrono::milliseconds interval) {
+    if (_background.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_background_mutex);
+        _stopping = false;
+    }
+    _background = std::thread(&RoutePool::background_loop, this, interval);
+}
+
+void RoutePool::stop_background() {
+    if (!_background.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_background_mutex);
+        _stopping = true;
+    }
+    _background_wake.notify_all();
+    _background.join();
+}
+
+bool RoutePool::take_improvement(Solution& solution) {
+    std::lock_guard<std::mutex> lock(_background_mutex);
+    if (!_has_improvement) {
+        return false;
+    }
+    std::swap(solution, _improvement);
+    _has_improvement = false;
+    return true;
+}
+
+void RoutePool::background_loop(std::chrono::milliseconds interval) {
+    Snapshot snapshot;
+    Solution recombined;
+    uint64_t last_version = 0;
+    bool ran_before = false;
+
+    std::unique_lock<std::mutex> lock(_background_mutex);
+    while (!_stopping) {
+        _background_wake.wait_for(lock, interval, [&] { return _stopping; });
+        if (_stopping) {
+            break;
+        }
+        lock.unlock();
+
+        double cost = std::numeric_limits<double>::infinity();
+        uint64_t version;
+        {
+            std::lock_guard<std::mutex> pool_lock(_mutex);
+            version = _version;
+        }
+        if (!ran_before || version != last_version) {
+            last_version = take_snapshot(snapshot);
+            ran_before = true;
+            if (!snapshot.costs.empty()) {
+                cost = solve(snapshot, recombined, std::chrono::steady_clock::now() + interval);
+            }
+        }
+
+        lock.lock();
+        if (cost < _improvement_cost - kEpsilon) {
+            std::swap(_improvement, recombined);
+            _improvement_cost = cost;
+            _has_improvement = true;
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "distance_matrix.h"
+#include "solution.h"
+
+// Every distinct route seen in any candidate during a search, each with a bitset of its loads and its cost
+// (500 plus minutes), so that good routes from different candidates can be recombined rather than thrown
+// away with the candidate.
+//
+// Recombination is a set partitioning problem: pick routes from the pool covering every load exactly once, at
+// minimum total cost. It's solved greedily (most cost effective routes first, with single load routes to fill
+// any gaps), then improved by local branching: force one more route in, kick out whatever it overlaps, and
+// refill the loads that frees up, keeping the change if it's cheaper overall. Overlap and subset checks are
+// done a whole bitset at a time (AVX2 when the CPU has it).
+//
+// Recombination can also run on a background thread every so often while the search keeps adding routes,
+// with anything better than the previous recombination handed back through take_improvement().
+class RoutePool {
+public:
+    static constexpr size_t kDefaultMaxBytes = 64ull * 1024 * 1024;
+
+    RoutePool(std::ofstream* log, size_t max_bytes = kDefaultMaxBytes);
+    ~RoutePool();
+
+    RoutePool(const RoutePool&) = delete;
+    RoutePool& operator=(const RoutePool&) = delete;
+
+    // Empties the pool for a different distance matrix. Not while the background thread is running.
+    void reset(const DistanceMatrix* distance_matrix);
+
+    // Adds every route of solution that isn't in the pool yet. A route whose loads are already in the pool
+    // replaces the pooled order if it's shorter. Safe to call while the background thread is running.
+    void add(const Solution& solution);
+
+    size_t size();
+
+    // Builds the best recombination it can find into solution, giving up on improving it once deadline passes.
+    // Returns false if there was nothing to recombine.
+    bool recombine(Solution& solution, std::chrono::steady_clock::time_point deadline);
+
+    // Recombines every interval on a background thread, whenever routes were added since the last time
+    void start_background(std::chrono::milliseconds interval);
+    void stop_background();
+
+    // If the background thread came up with something cheaper than anything it came up with before (since it
+    // was last taken), moves it into solution and returns true
+    bool take_improvement(Solution& solution);
+
+private:
+    // A copy of the pool. Between evictions the pool only grows (besides orders being replaced in place), so
+    // taking another snapshot into the same one only copies what changed since.
+    struct Snapshot {
+        size_t num_words = 0;
+        uint64_t generation = std::numeric_limits<uint64_t>::max();  // the pool's _generation when copied
+        size_t num_replaced = 0;                                        // how much of _replaced it's caught up on
+        std::vector<uint64_t> bits;
+        std::vector<double> costs;
+        Solution routes;
+    };
+
+    std::ofstream* _log;
+    size_t _max_bytes;
+    const DistanceMatrix* _distance_matrix;
+
+    std::mutex _mutex;  // guards everything below up to _version
+    size_t _num_words;
+    size_t _capacity;
+    std::vector<uint64_t> _bits;   // _num_words words per route
+    std::vector<double> _costs;
+    Solution _routes;              // the visiting order of each route
+    std::unordered_multimap<uint64_t, uint32_t> _index;  // hash of a route's bitset to its index
+    std::vector<uint64_t> _route_bits;  // scratch for add()
+    uint64_t _version;             // bumped whenever the pool changes
+    uint64_t _generation;          // bumped whenever routes get renumbered (reset or evict)
+    std::vector<uint32_t> _replaced;  // routes whose order got replaced in place, this generation
+
+    std::thread _background;
+    std::mutex _background_mutex;  // guards everything below
+    std::condition_variable _background_wake;
+    bool _stopping;
+    Solution _improvement;
+    double _improvement_cost;  // cheapest recombination so far, whether or not it's been taken yet
+    bool _has_improvement;
+
+    double route_minutes(const uint32_t* loads, size_t length) const;
+
+    // Drops the less cost effective half of the pool. Called with _mutex held.
+    void evict();
+    void rebuild_index();
+
+    // Brings snapshot up to date with the pool so it can be recombined without holding _mutex, returning the
+    // pool's _version. Only routes added or replaced since snapshot was last taken get copied, unless there's
+    // been an evict() or reset() since, which means copying the lot.
+    uint64_t take_snapshot(Snapshot& snapshot);
+
+    // The set partitioning itself, returns the cost of what it builds into solution
+    double solve(const Snapshot& snapshot, Solution& solution, std::chrono::steady_clock::time_point deadline) const;
+
+    void background_loop(std::chrono::milliseconds interval);
+};
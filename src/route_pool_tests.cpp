@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <thread>
+
+#include "evaluate_shared.h"
+#include "graph.h"
+#include "route_pool.h"
+#include "test_instances.h"
+
+namespace {
+
+const long double kMaxMinutes = 12 * 60;
+
+std::ofstream test_log;  // never opened, so logging goes nowhere
+
+// Loads in a random order, cut into routes whenever the next load wouldn't fit in time. If reversed, each
+// route's loads go in backwards (same sets, different orders).
+Solution random_solution(const DistanceMatrix& matrix, std::mt19937& gen, bool reversed = false) {
+    std::vector<uint32_t> loads(matrix.size() - 1);
+    std::iota(loads.begin(), loads.end(), 1);
+    std::shuffle(loads.begin(), loads.end(), gen);
+    std::vector<std::vector<uint32_t>> routes(1);
+    for (uint32_t load_id : loads) {
+        routes.back().push_back(load_id);
+        if (route_minutes(matrix, routes.back()) > kMaxMinutes) {
+            routes.back().pop_back();
+            routes.push_back({load_id});
+        }
+    }
+    Solution solution;
+    for (auto& route : routes) {
+        if (reversed) {
+            std::reverse(route.begin(), route.end());
+        }
+        solution.begin_route();
+        for (uint32_t load_id : route) {
+            solution.push_load(load_id);
+        }
+    }
+    return solution;
+}
+
+// Every load exactly once, every route done in time
+void expect_exact_cover(const Graph& graph, const Solution& solution) {
+    EXPECT_EQ(EvaluateShared::validateSolutionSchedules(solution, graph.numCoordinates()), 0);
+    for (size_t ii = 0; ii < solution.numRoutes(); ++ii) {
+        EXPECT_LE(route_minutes(graph.getDistanceMatrix(), solution.route(ii)), kMaxMinutes);
+    }
+}
+
+}  // namespace
+
+TEST(RoutePoolTests, RecombineGivesAnExactCover) {
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(21, 60));
+    RoutePool pool(&test_log);
+    pool.reset(&graph.getDistanceMatrix());
+    Solution solution;
+    EXPECT_FALSE(pool.recombine(solution, std::chrono::steady_clock::time_point::max()));
+
+    std::mt19937 gen(21);
+    for (int ii = 0; ii < 30; ++ii) {
+        pool.add(random_solution(graph.getDistanceMatrix(), gen));
+    }
+    ASSERT_TRUE(pool.recombine(solution, std::chrono::steady_clock::time_point::max()));
+    expect_exact_cover(graph, solution);
+
+    // even with no time to improve on the greedy cover
+    ASSERT_TRUE(pool.recombine(solution, std::chrono::steady_clock::now()));
+    expect_exact_cover(graph, solution);
+}
+
+TEST(RoutePoolTests, SameLoadsArePooledOnce) {
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(22, 40));
+    RoutePool pool(&test_log);
+    pool.reset(&graph.getDistanceMatrix());
+
+    std::mt19937 gen(22);
+    Solution solution = random_solution(graph.getDistanceMatrix(), gen);
+    pool.add(solution);
+    EXPECT_EQ(pool.size(), solution.numRoutes());
+    pool.add(solution);
+    EXPECT_EQ(pool.size(), solution.numRoutes());
+
+    // the same routes in another order, whichever is shorter stays
+    std::mt19937 same_gen(22);
+    pool.add(random_solution(graph.getDistanceMatrix(), same_gen, true));
+    EXPECT_EQ(pool.size(), solution.numRoutes());
+
+    pool.reset(&graph.getDistanceMatrix());
+    EXPECT_EQ(pool.size(), 0u);
+}
+
+TEST(RoutePoolTests, BackgroundKeepsUpWithAddsAndEvictions) {
+    // a zero byte budget means the minimum capacity, so this many solutions' worth of routes forces evictions
+    // while the background thread keeps taking snapshots
+    Graph graph({}, &test_log, kMaxMinutes);
+    graph.reset(random_coordinates(23, 50));
+    RoutePool pool(&test_log, 0);
+    pool.reset(&graph.getDistanceMatrix());
+    pool.start_background(std::chrono::milliseconds(1));
+
+    std::mt19937 gen(23);
+    Solution improvement;
+    size_t num_improvements = 0;
+    for (int ii = 0; ii < 300; ++ii) {
+        // same sets as the previous solution in reverse, so some orders get replaced in place too
+        std::mt19937 reversed_gen = gen;
+        pool.add(random_solution(graph.getDistanceMatrix(), reversed_gen, true));
+        pool.add(random_solution(graph.getDistanceMatrix(), gen));
+        if (ii % 10 == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        if (pool.take_improvement(improvement)) {
+            expect_exact_cover(graph, improvement);
+            ++num_improvements;
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    pool.stop_background();
+    if (pool.take_improvement(improvement)) {
+        expect_exact_cover(graph, improvement);
+        ++num_improvements;
+    }
+    EXPECT_GT(num_improvements, 0u);
+
+    Solution solution;
+    ASSERT_TRUE(pool.recombine(solution, std::chrono::steady_clock::time_point::max()));
+    expect_exact_cover(graph, solution);
+}
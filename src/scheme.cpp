@@ -80,7 +80,7 @@ Scheme Probs::select_scheme(bool at_hq) {
     }
 }
 
-size_t Probs::implement_scheme_and_select_next_load(Scheme scheme, const std::unordered_set<size_t>& reachable_loads, const std::vector<long double>* current_distances, const std::vector<long double>* hq_distances) {
+size_t Probs::implement_scheme_and_select_next_load(Scheme scheme, const std::vector<size_t>& reachable_loads, const double* current_distances, const double* hq_distances) {
     switch (scheme) {
         case Scheme::Home:
         {
@@ -115,43 +115,41 @@ size_t Probs::select_hq() {
     return 0;
 }
 
-size_t Probs::select_nearest(const std::unordered_set<size_t>& reachable_loads, const std::vector<long double>* current_distances) {
+size_t Probs::select_nearest(const std::vector<size_t>& reachable_loads, const double* current_distances) {
     if (reachable_loads.empty()) {
         // If there's no reachable loads, go to HQ
         return 0;
     } else if (reachable_loads.size() == 1) {
         // If there's only 1 reachable load, that's the answer
-        auto it = reachable_loads.cbegin();
-        return *it;
+        return reachable_loads.front();
     }
     size_t best_load_id = 0;
     long double nearest_distance = std::numeric_limits<long double>::infinity();
     for (size_t load_id : reachable_loads) {
-        if (current_distances->at(load_id) < nearest_distance) {
+        if (current_distances[load_id] < nearest_distance) {
             best_load_id = load_id;
-            nearest_distance = current_distances->at(load_id);
+            nearest_distance = current_distances[load_id];
         }
     }
     return best_load_id;
 }
 
-size_t Probs::select_onway_nearest(const std::unordered_set<size_t>& reachable_loads, const std::vector<long double>* current_distances, const std::vector<long double>* hq_distances) {
+size_t Probs::select_onway_nearest(const std::vector<size_t>& reachable_loads, const double* current_distances, const double* hq_distances) {
     if (reachable_loads.empty()) {
         // If there's no reachable loads, go to HQ
         return 0;
     } else if (reachable_loads.size() == 1) {
         // If there's only 1 reachable load, that's the answer
-        auto it = reachable_loads.cbegin();
-        return *it;
+        return reachable_loads.front();
     }
 
     // Onway nearest is a node that's closer to us than HQ. If all nodes are closer to HQ, we fallback to regular nearest
     size_t best_load_id = 0;
     long double nearest_distance = std::numeric_limits<long double>::infinity();
     for (size_t load_id : reachable_loads) {
-        if ((current_distances->at(load_id) < hq_distances->at(load_id)) && (current_distances->at(load_id) < nearest_distance)) {
+        if ((current_distances[load_id] < hq_distances[load_id]) && (current_distances[load_id] < nearest_distance)) {
             best_load_id = load_id;
-            nearest_distance = current_distances->at(load_id);
+            nearest_distance = current_distances[load_id];
         }
     }
     // We want to save the trouble of making a new driver if possible, by picking something closer to us than hq, but if that cannot be done, just pick the closest to us overall instead
@@ -162,7 +160,7 @@ size_t Probs::select_onway_nearest(const std::unordered_set<size_t>& reachable_l
     return best_load_id;
 }
 
-size_t Probs::select_weighted_nearest(const std::unordered_set<size_t>& reachable_loads, const std::vector<long double>* current_distances) {
+size_t Probs::select_weighted_nearest(const std::vector<size_t>& reachable_loads, const double* current_distances) {
     if (!generator) {
         return 0;
     }
@@ -171,23 +169,21 @@ size_t Probs::select_weighted_nearest(const std::unordered_set<size_t>& reachabl
         return 0;
     } else if (reachable_loads.size() == 1) {
         // If there's only 1 reachable load, that's the answer
-        auto it = reachable_loads.cbegin();
-        return *it;
+        return reachable_loads.front();
     }
 
-    std::vector<size_t> random_access_loads(reachable_loads.cbegin(), reachable_loads.cend());
     // get the sum
     long double sum = 0;
-    for (size_t load_id : random_access_loads) {
-        sum += current_distances->at(load_id);
+    for (size_t load_id : reachable_loads) {
+        sum += current_distances[load_id];
     }
     // find the weights, lower distances means higher weights
     std::vector<long double> weights;
-    for (size_t load_id : random_access_loads) {
-        weights.push_back(sum - current_distances->at(load_id));
+    for (size_t load_id : reachable_loads) {
+        weights.push_back(sum - current_distances[load_id]);
     }
     // sum of the weights is sum * n-1, where n is number of elements. This can be proven mathematically
-    long double weights_sum = sum * (random_access_loads.size() - 1);
+    long double weights_sum = sum * (reachable_loads.size() - 1);
     long double sum_so_far = 0;
     std::vector<long double> goalposts;
     for (size_t index = 0; index < weights.size(); ++index) {
@@ -210,10 +206,10 @@ size_t Probs::select_weighted_nearest(const std::unordered_set<size_t>& reachabl
         return 0;
     }
 
-    return random_access_loads[chosen_index];
+    return reachable_loads[chosen_index];
 }
 
-size_t Probs::select_random(const std::unordered_set<size_t>& reachable_loads) {
+size_t Probs::select_random(const std::vector<size_t>& reachable_loads) {
     if (!generator) {
         return 0;
     }
@@ -222,14 +218,12 @@ size_t Probs::select_random(const std::unordered_set<size_t>& reachable_loads) {
         return 0;
     } else if (reachable_loads.size() == 1) {
         // If there's only 1 reachable load, that's the answer
-        auto it = reachable_loads.cbegin();
-        return *it;
+        return reachable_loads.front();
     }
 
-    std::vector<size_t> random_access_loads(reachable_loads.cbegin(), reachable_loads.cend());
-    std::uniform_int_distribution<size_t> distribution(0, random_access_loads.size() - 1);
+    std::uniform_int_distribution<size_t> distribution(0, reachable_loads.size() - 1);
     size_t index = distribution(*generator);
-    return random_access_loads[index];
+    return reachable_loads[index];
 }
 
 std::string Probs::to_string() {
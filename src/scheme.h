@@ -3,7 +3,6 @@
 #include <cstddef>
 #include <random>
 #include <string>
-#include <unordered_set>
 #include <vector>
 
 enum class Scheme {
@@ -31,8 +30,9 @@ public:
     // select a scheme. Note that we ignore probHq if we're already at HQ, which only happens at the start. Otherwise, it is considered.
     Scheme select_scheme(bool at_hq);
 
-    // implements scheme scheme and returns the load to do next, which is either one of the items in reachable_loads or zero (in the event we chose to deliberately return to HQ)
-    size_t implement_scheme_and_select_next_load(Scheme scheme, const std::unordered_set<size_t>& reachable_loads, const std::vector<long double>* current_distances, const std::vector<long double>* hq_distances);
+    // implements scheme scheme and returns the load to do next, which is either one of the items in reachable_loads or zero (in the event we chose to deliberately return to HQ).
+    // Note Graph::plan_path_for_driver doesn't come here for GreedyNearest or OnwayNearest, it runs masked_argmin() over the distance row directly instead.
+    size_t implement_scheme_and_select_next_load(Scheme scheme, const std::vector<size_t>& reachable_loads, const double* current_distances, const double* hq_distances);
 
     std::string to_string();
 
@@ -52,8 +52,8 @@ private:
 
     void init_goalposts();
     size_t select_hq();
-    size_t select_nearest(const std::unordered_set<size_t>& reachable_loads, const std::vector<long double>* current_distances);
-    size_t select_onway_nearest(const std::unordered_set<size_t>& reachable_loads, const std::vector<long double>* current_distances, const std::vector<long double>* hq_distances);
-    size_t select_weighted_nearest(const std::unordered_set<size_t>& reachable_loads, const std::vector<long double>* current_distances);
-    size_t select_random(const std::unordered_set<size_t>& reachable_loads);
+    size_t select_nearest(const std::vector<size_t>& reachable_loads, const double* current_distances);
+    size_t select_onway_nearest(const std::vector<size_t>& reachable_loads, const double* current_distances, const double* hq_distances);
+    size_t select_weighted_nearest(const std::vector<size_t>& reachable_loads, const double* current_distances);
+    size_t select_random(const std::vector<size_t>& reachable_loads);
 };
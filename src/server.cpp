@@ -0,0 +1,417 @@
+#include "server.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "evaluate_shared.h"
+#include "graph.h"
+#include "solver.h"
+
+struct Server::Request {
+    enum class Kind {
+        Text,
+        Coordinates,
+        File,
+        Shutdown,
+        Invalid,
+    };
+
+    Kind kind = Kind::Invalid;
+    long long budget_ms = 0;
+    std::chrono::steady_clock::time_point received;
+    std::vector<std::string> lines;
+    std::vector<Coordinate> coordinates;
+    std::string path;
+    std::string error;
+};
+
+struct Server::WorkerState {
+    std::ofstream log;
+    std::mt19937 gen;
+    Graph graph;
+    // kept across requests along with the graph, so candidate and result buffers are already sized
+    Solver solver;
+    SolverResult result;
+
+    WorkerState(size_t index __attribute__((unused)), long double max_minutes, long double target_gap)
+    : gen(std::random_device()())
+    , graph(std::vector<std::string>(), &log, max_minutes)
+    , solver(&gen, &log, max_minutes, target_gap) {
+        // every worker is already solving in parallel, a recombination thread each would oversubscribe the cores
+        solver.set_background_recombination(false);
+#if LOGGING
+        // one log per worker, otherwise concurrent requests would interleave in the same file
+        log.open("debug-log-worker" + std::to_string(index) + ".out");
+#endif
+    }
+};
+
+namespace {
+
+// Buffered line reader over a socket
+class FdLineReader {
+public:
+    explicit FdLineReader(int fd)
+    : _fd(fd)
+    , _begin(0)
+    , _end(0) {}
+
+    bool read_line(std::string& line) {
+        line.clear();
+        while (true) {
+            for (size_t ii = _begin; ii < _end; ++ii) {
+                if (_buffer[ii] == '\n') {
+                    line.append(_buffer + _begin, ii - _begin);
+                    _begin = ii + 1;
+                    return true;
+                }
+            }
+            line.append(_buffer + _begin, _end - _begin);
+            _begin = _end = 0;
+            ssize_t count = ::read(_fd, _buffer, sizeof(_buffer));
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                // end of input, only counts as a line if there was something on it
+                return !line.empty();
+            }
+            _end = static_cast<size_t>(count);
+        }
+    }
+
+private:
+    int _fd;
+    char _buffer[65536];
+    size_t _begin;
+    size_t _end;
+};
+
+bool write_all(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t count = ::write(fd, data.data() + written, data.size() - written);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        written += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+}  // namespace
+
+Server::Server(size_t num_workers, long double max_minutes, long double target_gap)
+: _max_minutes(max_minutes)
+, _target_gap(target_gap)
+, _shutting_down(false)
+, _listen_fd(-1)
+, _pool(num_workers) {
+    for (size_t ii = 0; ii < _pool.size(); ++ii) {
+        _workers.push_back(std::make_unique<WorkerState>(ii, max_minutes, target_gap));
+    }
+}
+
+Server::~Server() = default;
+
+bool Server::read_request(const std::function<bool(std::string&)>& read_line, Request& request) {
+    request = Request();
+    std::string line;
+    // skip blank lines between requests
+    do {
+        if (!read_line(line)) {
+            return false;
+        }
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+    } while (line.empty());
+    request.received = std::chrono::steady_clock::now();
+
+    std::stringstream header(line);
+    std::string command;
+    long long count = 0;
+    header >> command;
+    if (command == "SHUTDOWN") {
+        request.kind = Request::Kind::Shutdown;
+        return true;
+    }
+    if (command == "FILE") {
+        if (!(header >> request.budget_ms >> request.path)) {
+            request.error = "expected FILE <budget_ms> <path>";
+            return true;
+        }
+        request.kind = Request::Kind::File;
+        return true;
+    }
+    if (command != "SOLVE" && command != "COORDS") {
+        request.error = "unknown command " + command;
+        return true;
+    }
+    if (!(header >> request.budget_ms >> count)) {
+        request.error = "expected " + command + " <budget_ms> <count>";
+        return true;
+    }
+    // checked before anything gets sized by it, a bogus count would otherwise throw (or eat all the memory)
+    if (count < 0 || count > static_cast<long long>(kMaxRequestLoads)) {
+        request.error = "count " + std::to_string(count) + " out of range";
+        return true;
+    }
+
+    if (command == "SOLVE") {
+        request.lines.reserve(static_cast<size_t>(count));
+        for (long long ii = 0; ii < count; ++ii) {
+            if (!read_line(line)) {
+                request.error = "ran out of input reading problem lines";
+                return true;
+            }
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            request.lines.push_back(line);
+        }
+        request.kind = Request::Kind::Text;
+        return true;
+    }
+
+    // HQ sits at the origin, loads follow in order
+    request.coordinates.assign(static_cast<size_t>(count) + 1, Coordinate());
+    for (size_t ii = 1; ii < request.coordinates.size(); ++ii) {
+        if (!read_line(line)) {
+            request.error = "ran out of input reading coordinates";
+            return true;
+        }
+        std::stringstream ss(line);
+        Coordinate& coord = request.coordinates[ii];
+        if (!(ss >> coord.pickupX >> coord.pickupY >> coord.dropOffX >> coord.dropOffY)) {
+            request.error = "malformed coordinates for load " + std::to_string(ii);
+            return true;
+        }
+    }
+    request.kind = Request::Kind::Coordinates;
+    return true;
+}
+
+std::future<std::string> Server::submit(std::shared_ptr<Request> request) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> response = promise->get_future();
+    _pool.submit([this, request, promise](size_t worker_index) {
+        // Anything thrown on a pool thread would terminate the whole server, so a request that makes parsing (or an
+        // allocation) throw just gets an error back
+        std::string response;
+        try {
+            response = solve(worker_index, *request);
+        } catch (const std::exception& e) {
+            response = std::string("ERROR unable to solve problem: ") + e.what() + "\n";
+        } catch (...) {
+            response = "ERROR unable to solve problem\n";
+        }
+        promise->set_value(response);
+    });
+    return response;
+}
+
+std::string Server::solve(size_t worker_index, const Request& request) {
+    WorkerState& state = *_workers[worker_index];
+    if (request.kind == Request::Kind::Text) {
+        state.graph.reset(request.lines);
+    } else if (request.kind == Request::Kind::Coordinates) {
+        state.graph.reset(request.coordinates);
+    } else {
+        std::string error;
+        if (state.graph.load(request.path, error) != 0) {
+            return "ERROR " + error + "\n";
+        }
+    }
+
+    Solver& solver = state.solver;
+    // the budget includes any time spent waiting in the queue
+    solver.set_deadline(request.budget_ms > 0 ? request.received + std::chrono::milliseconds(request.budget_ms)
+                                              : std::chrono::steady_clock::time_point::max());
+    SolverResult& result = state.result;
+    if (solver.solve(state.graph, result) != 0) {
+        return "ERROR unable to solve problem\n";
+    }
+
+    std::stringstream response;
+    response.precision(17);
+    response << "OK " << result.solution.numRoutes() << " " << result.cost << " " << result.gap << "\n";
+    EvaluateShared::outputSolutionSchedules(response, result.solution);
+    return response.str();
+}
+
+int Server::serve_stdio() {
+    // Responses go out in request order from their own thread, so a slow request doesn't hold up reading more
+    std::deque<std::future<std::string>> pending;
+    std::mutex pending_mutex;
+    std::condition_variable pending_ready;
+    bool done_reading = false;
+
+    std::thread writer([&]() {
+        while (true) {
+            std::future<std::string> next;
+            {
+                std::unique_lock<std::mutex> lock(pending_mutex);
+                pending_ready.wait(lock, [&] { return done_reading || !pending.empty(); });
+                if (pending.empty()) {
+                    return;
+                }
+                next = std::move(pending.front());
+                pending.pop_front();
+            }
+            std::cout << next.get() << std::flush;
+        }
+    });
+
+    auto read_line = [](std::string& line) {
+        return static_cast<bool>(std::getline(std::cin, line));
+    };
+    while (true) {
+        auto request = std::make_shared<Request>();
+        if (!read_request(read_line, *request) || request->kind == Request::Kind::Shutdown) {
+            break;
+        }
+        bool invalid = (request->kind == Request::Kind::Invalid);
+        std::future<std::string> response;
+        if (invalid) {
+            std::promise<std::string> error;
+            error.set_value("ERROR " + request->error + "\n");
+            response = error.get_future();
+        } else {
+            response = submit(request);
+        }
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            pending.push_back(std::move(response));
+        }
+        pending_ready.notify_one();
+        if (invalid) {
+            // no telling where the next request starts, so stop reading (like a socket connection does)
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        done_reading = true;
+    }
+    pending_ready.notify_one();
+    writer.join();
+    return 0;
+}
+
+int Server::serve_socket(const std::string& socket_path) {
+    // a client hanging up mid response shouldn't take the whole server down
+    std::signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << socket_path << std::endl;
+        return 1;
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    _listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_listen_fd < 0) {
+        std::cerr << "Unable to create socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    ::unlink(socket_path.c_str());
+    if (::bind(_listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(_listen_fd, 64) < 0) {
+        std::cerr << "Unable to listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        ::close(_listen_fd);
+        return 1;
+    }
+
+    while (!_shutting_down) {
+        int fd = ::accept(_listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // either shutting down (begin_shutdown() pulled the rug out from under accept) or something broke
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_connections_mutex);
+            if (_shutting_down) {
+                ::close(fd);
+                break;
+            }
+            _connections.insert(fd);
+        }
+        // Connection threads only do I/O, the actual solving happens on the pool
+        std::thread(&Server::handle_connection, this, fd).detach();
+    }
+
+    begin_shutdown();
+    {
+        std::unique_lock<std::mutex> lock(_connections_mutex);
+        _connections_done.wait(lock, [this] { return _connections.empty(); });
+    }
+    ::close(_listen_fd);
+    ::unlink(socket_path.c_str());
+    return 0;
+}
+
+void Server::handle_connection(int fd) {
+    FdLineReader reader(fd);
+    auto read_line = [&reader](std::string& line) {
+        return reader.read_line(line);
+    };
+
+    while (true) {
+        auto request = std::make_shared<Request>();
+        if (!read_request(read_line, *request)) {
+            break;
+        }
+        if (request->kind == Request::Kind::Shutdown) {
+            write_all(fd, "OK\n");
+            begin_shutdown();
+            break;
+        }
+        if (request->kind == Request::Kind::Invalid) {
+            // no telling where the next request starts, so give up on this connection
+            write_all(fd, "ERROR " + request->error + "\n");
+            break;
+        }
+        if (!write_all(fd, submit(request).get())) {
+            break;
+        }
+    }
+
+    ::close(fd);
+    std::lock_guard<std::mutex> lock(_connections_mutex);
+    _connections.erase(fd);
+    if (_connections.empty()) {
+        _connections_done.notify_all();
+    }
+}
+
+void Server::begin_shutdown() {
+    std::lock_guard<std::mutex> lock(_connections_mutex);
+    if (_shutting_down.exchange(true)) {
+        return;
+    }
+    // wake up accept() and any connections sitting idle waiting for their next request
+    ::shutdown(_listen_fd, SHUT_RDWR);
+    for (int fd : _connections) {
+        ::shutdown(fd, SHUT_RD);
+    }
+}
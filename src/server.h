@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "coordinate.h"
+#include "thread_pool.h"
+
+// Long running solver, so callers that solve lots of problems don't pay for process startup, seeding, and
+// allocating everything from scratch each time. Requests are solved on a warm ThreadPool, and every worker
+// keeps its own Graph (whose buffers get reused between requests), random generator, and log file.
+//
+// Requests and responses are line based. A request is one of:
+//
+//   SOLVE <budget_ms> <num_lines>     followed by num_lines lines in the usual problem file format
+//                                     (including the "loadNumber pickup dropoff" header line)
+//   COORDS <budget_ms> <num_loads>    followed by num_loads lines of "pickupX pickupY dropoffX dropoffY",
+//                                     for loads 1 thru num_loads in order
+//   FILE <budget_ms> <path>           solve a problem file on the server's filesystem, either text or a binary
+//                                     instance file (which is memory mapped, so its distance matrix is shared
+//                                     through the page cache rather than rebuilt)
+//   SHUTDOWN                          stops the server once in flight requests are done
+//
+// budget_ms is how long the request may take (counted from when it was read), or 0 for no limit. The response
+// to a solve is "OK <num_routes> <cost> <gap>" followed by num_routes lines of schedules in the usual output
+// format, or a single "ERROR <message>" line (also when the problem lines themselves don't parse). A malformed
+// request ends the connection (or with stdio, the input) after its ERROR response, since there's no telling
+// where the next request would start.
+class Server {
+public:
+    // Most lines (or loads) a single request may have, far beyond anything one request's distance matrix could hold
+    static constexpr size_t kMaxRequestLoads = 1000000;
+
+    // num_workers of zero means one per hardware thread
+    Server(size_t num_workers, long double max_minutes, long double target_gap);
+    ~Server();
+
+    // Listens on a Unix domain socket at socket_path, with each connection able to send any number of requests
+    // one after another. Returns once a SHUTDOWN request comes in, nonzero on trouble.
+    int serve_socket(const std::string& socket_path);
+
+    // Reads requests from stdin, solving them concurrently, and writes responses to stdout in the same order
+    // the requests came in. Returns at end of input or on a SHUTDOWN request.
+    int serve_stdio();
+
+private:
+    struct Request;
+    struct WorkerState;
+
+    long double _max_minutes;
+    long double _target_gap;
+    std::vector<std::unique_ptr<WorkerState>> _workers;
+
+    std::atomic<bool> _shutting_down;
+    int _listen_fd;
+    std::mutex _connections_mutex;
+    std::condition_variable _connections_done;
+    std::unordered_set<int> _connections;
+
+    // Declared last so it's destroyed first, ie the workers are joined before the state they use goes away
+    ThreadPool _pool;
+
+    // Reads one request using read_line, returns false at end of input
+    static bool read_request(const std::function<bool(std::string&)>& read_line, Request& request);
+
+    // Queues the request on the pool, the future holds the response text
+    std::future<std::string> submit(std::shared_ptr<Request> request);
+
+    std::string solve(size_t worker_index, const Request& request);
+
+    void handle_connection(int fd);
+    void begin_shutdown();
+};
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server.h"
+
+namespace {
+
+const long double kMaxMinutes = 12 * 60;
+
+// One client connection to a server listening on a Unix domain socket
+class TestClient {
+public:
+    explicit TestClient(const std::string& socket_path)
+    : _fd(::socket(AF_UNIX, SOCK_STREAM, 0)) {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+        // the server may not be listening quite yet
+        for (int attempt = 0; attempt < 200; ++attempt) {
+            if (::connect(_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+                _connected = true;
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    ~TestClient() {
+        ::close(_fd);
+    }
+
+    bool connected() const {
+        return _connected;
+    }
+
+    void send(const std::string& request) {
+        size_t written = 0;
+        while (written < request.size()) {
+            ssize_t count = ::write(_fd, request.data() + written, request.size() - written);
+            ASSERT_GT(count, 0);
+            written += static_cast<size_t>(count);
+        }
+    }
+
+    // Empty once the server has closed the connection
+    std::string read_line() {
+        std::string line;
+        char c;
+        while (::read(_fd, &c, 1) == 1) {
+            if (c == '\n') {
+                return line;
+            }
+            line += c;
+        }
+        return line;
+    }
+
+    // First line of the response, after reading past any schedules that follow an OK
+    std::string read_response() {
+        std::string status = read_line();
+        if (status.compare(0, 3, "OK ") == 0) {
+            std::stringstream ss(status.substr(3));
+            size_t num_routes = 0;
+            ss >> num_routes;
+            for (size_t ii = 0; ii < num_routes; ++ii) {
+                read_line();
+            }
+        }
+        return status;
+    }
+
+private:
+    int _fd;
+    bool _connected = false;
+};
+
+const char* kValidRequest = "COORDS 0 2\n1 1 2 2\n-3 4 -5 6\n";
+
+}  // namespace
+
+TEST(ServerTests, MalformedRequestsGetErrors) {
+    std::string socket_path = testing::TempDir() + "vehicle_routing_server_test.sock";
+    Server server(1, kMaxMinutes, 0.01);
+    int status = -1;
+    std::thread serving([&]() {
+        status = server.serve_socket(socket_path);
+    });
+
+    {
+        TestClient client(socket_path);
+        ASSERT_TRUE(client.connected());
+
+        // problem lines that don't parse are the worker's problem, and the connection carries on after
+        client.send("SOLVE 0 2\nloadNumber pickup dropoff\n1 (a,b) (c,d)\n");
+        EXPECT_EQ(client.read_response().compare(0, 6, "ERROR "), 0);
+        client.send(kValidRequest);
+        EXPECT_EQ(client.read_response().compare(0, 5, "OK 1 "), 0);
+    }
+
+    for (const char* bad_count : {"SOLVE 0 -1\n", "COORDS 0 -1\n", "SOLVE 0 99999999999\n", "COORDS 0 x\n"}) {
+        // the count itself is bad, so the connection ends after the error but the server keeps going
+        TestClient client(socket_path);
+        ASSERT_TRUE(client.connected());
+        client.send(bad_count);
+        EXPECT_EQ(client.read_response().compare(0, 6, "ERROR "), 0) << bad_count;
+        EXPECT_EQ(client.read_line(), "");
+    }
+
+    {
+        TestClient client(socket_path);
+        ASSERT_TRUE(client.connected());
+        client.send(kValidRequest);
+        EXPECT_EQ(client.read_response().compare(0, 5, "OK 1 "), 0);
+        client.send("SHUTDOWN\n");
+        EXPECT_EQ(client.read_line(), "OK");
+    }
+
+    serving.join();
+    EXPECT_EQ(status, 0);
+}
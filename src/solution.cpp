@@ -0,0 +1,21 @@
+#include "solution.h"
+
+void Solution::assign(const std::vector<std::vector<size_t>>& schedules) {
+    clear();
+    for (const auto& schedule : schedules) {
+        begin_route();
+        for (size_t load_id : schedule) {
+            push_load(load_id);
+        }
+    }
+}
+
+std::vector<std::vector<size_t>> Solution::to_schedules() const {
+    std::vector<std::vector<size_t>> schedules;
+    schedules.reserve(numRoutes());
+    for (size_t ii = 0; ii < numRoutes(); ++ii) {
+        RouteView view = route(ii);
+        schedules.emplace_back(view.begin(), view.end());
+    }
+    return schedules;
+}
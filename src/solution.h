@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One driver's route inside a Solution, ie a range of load ids that points into the Solution's buffer
+struct RouteView {
+    const uint32_t* loads;
+    size_t length;
+
+    const uint32_t* begin() const {
+        return loads;
+    }
+
+    const uint32_t* end() const {
+        return loads + length;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    bool empty() const {
+        return length == 0;
+    }
+};
+
+// A candidate solution stored as one "giant tour" of load ids, every driver's route back to back, plus the
+// offset where each route starts. Compared to a vector<vector<size_t>> this is two allocations total rather
+// than one per driver, and since clear() keeps both buffers around, one Solution reused for every candidate
+// doesn't allocate at all once it's warmed up.
+//
+// Routes are built one at a time at the end: begin_route(), push_load() as many times as needed, and
+// optionally truncate_route() to back out of loads that turned out not to fit.
+class Solution {
+public:
+    Solution()
+    : _route_offsets(1, 0) {}
+
+    void clear() {
+        _loads.clear();
+        _route_offsets.assign(1, 0);
+    }
+
+    size_t numRoutes() const {
+        return _route_offsets.size() - 1;
+    }
+
+    size_t numLoads() const {
+        return _loads.size();
+    }
+
+    RouteView route(size_t index) const {
+        return RouteView{_loads.data() + _route_offsets[index], _route_offsets[index + 1] - _route_offsets[index]};
+    }
+
+    // Writable access to route index's loads, for reordering them in place (see Resequencer)
+    uint32_t* mutable_route(size_t index) {
+        return _loads.data() + _route_offsets[index];
+    }
+
+    // Starts a new, empty route at the end
+    void begin_route() {
+        _route_offsets.push_back(static_cast<uint32_t>(_loads.size()));
+    }
+
+    // Adds a load to the end of the last route
+    void push_load(size_t load_id) {
+        _loads.push_back(static_cast<uint32_t>(load_id));
+        ++_route_offsets.back();
+    }
+
+    // Number of loads in the last route
+    size_t last_route_length() const {
+        return _route_offsets.back() - _route_offsets[_route_offsets.size() - 2];
+    }
+
+    // Shrinks the last route down to its first length loads
+    void truncate_route(size_t length) {
+        _route_offsets.back() = _route_offsets[_route_offsets.size() - 2] + static_cast<uint32_t>(length);
+        _loads.resize(_route_offsets.back());
+    }
+
+    // Drops the last route entirely
+    void pop_route() {
+        truncate_route(0);
+        _route_offsets.pop_back();
+    }
+
+    // Conversions to and from the nested representation, for the places that aren't performance sensitive
+    void assign(const std::vector<std::vector<size_t>>& schedules);
+    std::vector<std::vector<size_t>> to_schedules() const;
+
+private:
+    std::vector<uint32_t> _loads;
+    std::vector<uint32_t> _route_offsets;  // numRoutes() + 1 entries, route ii is [offsets[ii], offsets[ii+1])
+};
@@ -0,0 +1,268 @@
+#include "solver.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <utility>
+
+#include "evaluate_shared.h"
+#include "exact_solver.h"
+#include "greedy_enumerator.h"
+#include "lower_bound.h"
+#include "regret_inserter.h"
+
+int Solver::solve(Graph& g, SolverResult& result) {
+    if (g.numCoordinates() < 2) {
+        // No loads, so no drivers needed
+        result.solution.clear();
+        result.cost = 0;
+        result.gap = 0;
+        return 0;
+    }
+
+    // Small instances are solved exactly, so there's no need to run any of the heuristics below. If the exact
+    // solver bails (ran out of time, or somehow produced something invalid), we fall through to the heuristics.
+    if (ExactSolver::fits(g.numCoordinates() - 1) && solve_exactly(g, result)) {
+        return 0;
+    }
+
+#if LOGGING
+    int many = 60;
+    int some = 30;
+    int few = 10;
+#else
+    int many = 360;
+    int some = 180;
+    int few = 60;
+#endif
+
+    std::vector<std::pair<Probs, int>> stuff_to_try = {
+        // {Probs(_gen, 1, 0, 0, 0, 0), 1},  // do this once (deterministic solution): always go to HQ, each worker never delivers more than 1 load
+        {Probs(_gen, 0, 1, 0, 0, 0, false), 1},  // do this once (deterministic solution): always greedily deliver the nearest load with a single driver, maximizes load per driver
+        {Probs(_gen, 0, 0, 1, 0, 0, false), 1},  // do this once (deterministic solution): always greedily deliver the nearest load that's father from HQ (falls back to nearest load), maximizes load per driver
+        {Probs(_gen, 0, 0, 0, 1, 0, false), many}, // do this many times: always go to weighted nearest neighbor if possible, with closer neighbors having higher probability
+        {Probs(_gen, 0, 0, 0, 0, 1, false), many}, // do this many times: always go to a random neighbor if possible
+        {Probs(_gen, 10, 90, 100, 0, 0, false), many}, // do this many times: greedily deliver nearest load with a chance to return early to HQ
+        {Probs(_gen, 10, 0, 0, 190, 0, false), many}, // do this many times: weighted neighbor with a chance to return early to HQ
+        {Probs(_gen, 10, 0, 0, 0, 190, false), many}, // do this many times: random with chance to return early to HQ
+        {Probs(_gen, 10, 45, 45, 100, 0, false), some}, // do this some number of times: weighted btw nearest neighbor vs weighted nearest with a chance to return early to HQ
+        {Probs(_gen, 10, 45, 45, 0, 100, false), some}, // do this some number of times: weighted btw nearest neighbor vs random neighbor with a chance to return early to HQ
+        {Probs(_gen, 100, 16, 16, 18, 50, false), some}, // do this some number of times: bail to HQ half the time, random neighbor quarter of the time, otherwise other schemes
+
+        {Probs(_gen, 0, 1, 0, 0, 0, true), few},  // few times deterministic nearest neighbor w a random starting point for every driver, maximize load per driver
+        {Probs(_gen, 0, 0, 1, 0, 0, true), few},  // few times deterministic nearest load that's father from HQ, but a random starting point for every driver
+        {Probs(_gen, 10, 90, 0, 0, 0, true), few},  // few times nearest neighbors, 10% chance of early exit, different starting points
+        {Probs(_gen, 10, 0, 90, 0, 0, true), few},  // few times nearest neighbors farther from HG, 10% chance of early exit, different starting points
+        {Probs(_gen, 10, 45, 45, 100, 0, true), some}, // do this some number of times: different starting points, but weighted btw nearest neighbor vs weighted nearest with a chance to return early to HQ
+        {Probs(_gen, 10, 45, 45, 0, 100, true), some}, // do this some number of times: different starting points, but weighted btw nearest neighbor vs random neighbor with a chance to return early to HQ
+        {Probs(_gen, 100, 16, 16, 18, 50, true), some}, // do this some number of times: different starting points, but bail to HQ half the time, random neighbor quarter of the time, otherwise other schemes
+
+    };
+    
+    long double lowest_cost = std::numeric_limits<long double>::infinity();
+
+    std::vector<Coordinate> coordinates = g.getCoordinates();
+    Solution& best_solution = result.solution;
+    best_solution.clear();
+
+    // Try a solution that involves giving 1 load to each worker
+    for (size_t ii = 1; ii < g.numCoordinates(); ++ii) {
+        best_solution.begin_route();
+        best_solution.push_load(ii);
+    }
+    if (EvaluateShared::validateSolutionSchedules(best_solution, g.numCoordinates(), _validation_scratch) != 0) {
+        // Uh oh that failed validation??? That's not good. Exit with error.
+#if LOGGING
+        *_log << "fallback solution failed, bailing" << std::endl;
+#endif
+        return 1;
+    } else {
+        // Awesome! It worked! That's our lowest cost we will use against the stuff_to_try attempts mentioned above.
+        lowest_cost = EvaluateShared::getSolutionCost(coordinates, best_solution, _max_minutes);
+    }
+
+#if LOGGING
+    *_log << "lowest_cost = " << lowest_cost << std::endl;
+#endif
+
+    // Anything within target_gap of this bound is good enough, no point spending more time searching
+    LowerBound lower_bound(&g.getDistanceMatrix(), _max_minutes, _log);
+    lower_bound.set_deadline(_deadline);
+    lower_bound.compute();
+    bool close_enough = (lower_bound.gap(lowest_cost) <= _target_gap);
+    _resequencer.reset(&g.getDistanceMatrix());
+    _route_pool.reset(&g.getDistanceMatrix());
+    bool out_of_time = false;
+
+#if LOGGING
+    *_log << "lower_bound = " << lower_bound.bound() << std::endl;
+#endif
+
+    // Validates and scores a candidate, and if it beats the best so far, swaps it in (so candidate ends up holding whatever it
+    // replaced). Returns whether it was an improvement.
+    auto consider_candidate = [&](Solution& candidate_solution) {
+#if LOGGING
+        *_log << "Considering candidate solution:" << std::endl;
+        EvaluateShared::outputScheduleToLog(_log, candidate_solution);
+#endif
+
+        int status = EvaluateShared::validateSolutionSchedules(candidate_solution, g.numCoordinates(), _validation_scratch);
+        if (status != 0) {
+#if LOGGING
+            *_log << "Candidate fails validation" << std::endl;
+#endif
+            return false;
+        }
+        long double candidate_cost = EvaluateShared::getSolutionCost(coordinates, candidate_solution, _max_minutes);
+#if LOGGING
+        *_log << "Candidate passes validation" << std::endl;
+        *_log << "candidate_cost = " << candidate_cost << std::endl;
+#endif
+        // Even a losing candidate can have a few good routes in it
+        _route_pool.add(candidate_solution);
+        if (candidate_cost >= lowest_cost) {
+            return false;
+        }
+
+        // Reordering loads within routes only ever makes them shorter, so an improvement stays an improvement. Most
+        // routes are shared with earlier candidates, which makes this mostly cache lookups.
+        if (_resequencer.optimize(candidate_solution) > 0) {
+            candidate_cost = EvaluateShared::getSolutionCost(coordinates, candidate_solution, _max_minutes);
+#if LOGGING
+            *_log << "Resequenced candidate_cost = " << candidate_cost << std::endl;
+#endif
+        }
+        std::swap(best_solution, candidate_solution);
+        _route_pool.add(best_solution);
+        lowest_cost = candidate_cost;
+        close_enough = (lower_bound.gap(lowest_cost) <= _target_gap);
+#if LOGGING
+        *_log << "We found a new best solution" << std::endl;
+        *_log << "lowest_cost = " << lowest_cost << std::endl;
+#endif
+        return true;
+    };
+
+    // Recombining the routes found so far runs alongside the search, whatever it comes up with gets picked up
+    // between candidates. With a single core that would only slow the search down, leaving just the final
+    // recombination below.
+    if (!close_enough && _background_recombination && std::thread::hardware_concurrency() > 1) {
+        _route_pool.start_background(std::chrono::milliseconds(100));
+    }
+
+    // Regret insertion goes first since it's a single cheap pass that usually beats everything else on its own,
+    // which matters most when the deadline is tight
+    if (g.numCoordinates() - 1 <= RegretInserter::kMaxLoads) {
+        RegretInserter inserter(&g.getDistanceMatrix(), _max_minutes, _log);
+        inserter.set_thread_pool(_pool);
+        inserter.set_deadline(_deadline);
+        for (size_t k : {2, 3}) {
+            if (close_enough) {
+                break;
+            }
+            if (inserter.solve(k, _candidate) && consider_candidate(_candidate)) {
+#if LOGGING
+                *_log << "Regret-" << k << " insertion" << std::endl;
+#endif
+            }
+        }
+    }
+
+    // The deterministic greedy walks from every possible first load, with later drivers starting nearest HQ (the
+    // rows above sample random starts for every driver instead)
+    GreedyEnumerator enumerator(&g.getDistanceMatrix(), _max_minutes, _log);
+    enumerator.set_thread_pool(_pool);
+    enumerator.set_deadline(_deadline);
+    for (Scheme scheme : {Scheme::GreedyNearest, Scheme::OnwayNearest}) {
+        if (close_enough) {
+            break;
+        }
+        if (enumerator.solve(scheme, _candidate)) {
+            consider_candidate(_candidate);
+        }
+    }
+
+    // For each item in stuff_to_try, run w the probs parameters a # of times specified by num_times (there's randomness involved)
+    // Anytime we get something better than the best_solution, we keep that solution
+    for (auto& try_it : stuff_to_try) {
+        if (close_enough || out_of_time) {
+            break;
+        }
+        Probs& probs = try_it.first;
+        int num_times = try_it.second;
+        for (int ii = 0; ii < num_times && !close_enough; ++ii) {
+            if (std::chrono::steady_clock::now() >= _deadline) {
+#if LOGGING
+                *_log << "Out of time, stopping the search" << std::endl;
+#endif
+                out_of_time = true;
+                break;
+            }
+            g.plan_paths(probs, _candidate);
+            if (consider_candidate(_candidate)) {
+#if LOGGING
+                *_log << "Probs is " << probs.to_string() << std::endl;
+#endif
+            }
+            if (_route_pool.take_improvement(_candidate) && consider_candidate(_candidate)) {
+#if LOGGING
+                *_log << "Recombined routes from the pool" << std::endl;
+#endif
+            }
+        }
+    }
+
+    // One last recombination over everything the search turned up. Past the deadline it still builds the greedy
+    // cover, it just skips improving it.
+    _route_pool.stop_background();
+    if (!close_enough) {
+        auto recombine_until = std::min(_deadline, std::chrono::steady_clock::now() + std::chrono::milliseconds(250));
+        if (_route_pool.recombine(_candidate, recombine_until) && consider_candidate(_candidate)) {
+#if LOGGING
+            *_log << "Final recombination of " << _route_pool.size() << " pooled routes" << std::endl;
+#endif
+        }
+    }
+
+#if LOGGING
+    *_log << "Resequencer cache hits = " << _resequencer.cache_hits() << ", misses = " << _resequencer.cache_misses() << std::endl;
+#endif
+
+    result.cost = lowest_cost;
+    result.gap = lower_bound.gap(lowest_cost);
+    return 0;
+}
+
+bool Solver::solve_exactly(Graph& g, SolverResult& result) {
+    // Don't let the exact solver blow past our own deadline
+    long long time_limit_ms = 10000;
+    if (_deadline != std::chrono::steady_clock::time_point::max()) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(_deadline - std::chrono::steady_clock::now());
+        time_limit_ms = std::max<long long>(0, std::min<long long>(time_limit_ms, remaining.count()));
+    }
+
+    ExactSolver exact(&g.getDistanceMatrix(), _max_minutes, _log, ExactSolver::kDefaultMemoryLimitBytes, time_limit_ms);
+    exact.set_thread_pool(_pool);
+    std::vector<std::vector<size_t>> exact_solution;
+    if (!exact.solve(exact_solution) || EvaluateShared::validateSolutionSchedules(exact_solution, g.numCoordinates()) != 0) {
+#if LOGGING
+        *_log << "Exact solver failed, falling back to heuristics" << std::endl;
+#endif
+        return false;
+    }
+    long double cost = EvaluateShared::getSolutionCost(g.getCoordinates(), exact_solution, _max_minutes);
+    if (cost == std::numeric_limits<long double>::infinity()) {
+#if LOGGING
+        *_log << "Exact solver solution exceeds max minutes, falling back to heuristics" << std::endl;
+#endif
+        return false;
+    }
+
+#if LOGGING
+    *_log << "Exact solver found the optimal solution" << std::endl;
+#endif
+    result.solution.assign(exact_solution);
+    result.cost = cost;
+    result.gap = 0;
+    return true;
+}
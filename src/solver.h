@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include "graph.h"
+#include "resequencer.h"
+#include "route_pool.h"
+#include "solution.h"
+#include "thread_pool.h"
+
+struct SolverResult {
+    Solution solution;
+    long double cost;
+    long double gap;  // relative gap to the lower bound, 0 means provably optimal
+
+    SolverResult()
+    : cost(0)
+    , gap(0) {}
+};
+
+// Runs the whole search on a built Graph: the exact solver for small instances, otherwise the portfolio of
+// Probs schemes, stopping early once the best solution is within target_gap of the lower bound or once the
+// deadline passes. This is everything main() used to do between building the Graph and printing the answer,
+// pulled out so the server can run it per request.
+class Solver {
+public:
+    Solver(std::mt19937* gen, std::ofstream* log, long double max_minutes, long double target_gap)
+    : _gen(gen)
+    , _log(log)
+    , _max_minutes(max_minutes)
+    , _target_gap(target_gap)
+    , _deadline(std::chrono::steady_clock::time_point::max())
+    , _pool(nullptr)
+    , _background_recombination(true)
+    , _route_pool(log) {}
+
+    // Stop searching (returning the best solution so far) once this passes
+    void set_deadline(std::chrono::steady_clock::time_point deadline) {
+        _deadline = deadline;
+    }
+
+    // Lets route resequencing run in parallel on pool, which mustn't be the pool running this solve (see
+    // ThreadPool::run_all). Without one, everything happens on the calling thread.
+    void set_thread_pool(ThreadPool* pool) {
+        _pool = pool;
+        _resequencer.set_thread_pool(pool);
+    }
+
+    // Whether pooled routes get recombined on a background thread during the search (given a spare core).
+    // Turn it off when this solve is one of several already running in parallel, eg on server workers.
+    void set_background_recombination(bool enabled) {
+        _background_recombination = enabled;
+    }
+
+    // Returns nonzero on trouble, zero if result holds a valid solution
+    int solve(Graph& g, SolverResult& result);
+
+private:
+    std::mt19937* _gen;
+    std::ofstream* _log;
+    long double _max_minutes;
+    long double _target_gap;
+    std::chrono::steady_clock::time_point _deadline;
+    ThreadPool* _pool;
+    bool _background_recombination;
+
+    // Scratch space every candidate gets built into. When a candidate beats the best so far, the two are swapped
+    // rather than copied, and either way the buffers get reused for the next candidate (and the next solve).
+    Solution _candidate;
+
+    // validateSolutionSchedules() scratch, so validating a candidate doesn't allocate either
+    std::vector<char> _validation_scratch;
+
+    // Reorders loads within the routes of improving candidates, caching results across candidates
+    Resequencer _resequencer;
+
+    // Every route of every valid candidate, recombined into new candidates in the background and once more at
+    // the end
+    RoutePool _route_pool;
+
+    bool solve_exactly(Graph& g, SolverResult& result);
+};
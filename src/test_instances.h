@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "coordinate.h"
+#include "distance_matrix.h"
+
+// Helpers shared by the *_tests.cpp files
+
+// HQ at coordinates[0], then num_loads loads with pickups and dropoffs uniform in [-spread, spread]. Keeping
+// spread at 125 or under guarantees every load can be done by a driver on its own within 720 minutes (at
+// worst HQ to one corner, across to the opposite one and back to HQ is 4 sqrt(2) spread).
+inline std::vector<Coordinate> random_coordinates(uint32_t seed, size_t num_loads, long double spread = 100) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> position(-static_cast<double>(spread), static_cast<double>(spread));
+    std::vector<Coordinate> coordinates(1);
+    for (size_t ii = 0; ii < num_loads; ++ii) {
+        Coordinate coordinate;
+        coordinate.pickupX = position(gen);
+        coordinate.pickupY = position(gen);
+        coordinate.dropOffX = position(gen);
+        coordinate.dropOffY = position(gen);
+        coordinates.push_back(coordinate);
+    }
+    return coordinates;
+}
+
+// Minutes for one driver to do route (load ids) and get back to HQ
+template <typename Route>
+double route_minutes(const DistanceMatrix& matrix, const Route& route) {
+    double minutes = 0;
+    size_t current = 0;
+    for (size_t load_id : route) {
+        minutes += matrix[current][load_id];
+        current = load_id;
+    }
+    return minutes + matrix[current][0];
+}
@@ -0,0 +1,67 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+ThreadPool::ThreadPool(size_t num_threads)
+: _stopping(false) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t ii = 0; ii < num_threads; ++ii) {
+        _workers.emplace_back(&ThreadPool::run, this, ii);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _ready.notify_all();
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void(size_t)> task) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(std::move(task));
+    }
+    _ready.notify_one();
+}
+
+void ThreadPool::run_all(size_t num_items, const std::function<void(size_t, size_t)>& task) {
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining = num_items;
+    for (size_t ii = 0; ii < num_items; ++ii) {
+        submit([&, ii](size_t worker_index) {
+            task(worker_index, ii);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0) {
+                done.notify_all();
+            }
+        });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return remaining == 0; });
+}
+
+void ThreadPool::run(size_t worker_index) {
+    while (true) {
+        std::function<void(size_t)> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _ready.wait(lock, [this] { return _stopping || !_tasks.empty(); });
+            if (_tasks.empty()) {
+                // only get here when stopping and there's nothing left to do
+                return;
+            }
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+        task(worker_index);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that stay warm for the life of the pool, pulling tasks off a shared queue.
+// Each task is handed the index of the worker running it, so callers can keep per-worker state (log files,
+// random generators, reusable Graph buffers) in a plain vector indexed by worker.
+class ThreadPool {
+public:
+    // num_threads of zero means one per hardware thread
+    explicit ThreadPool(size_t num_threads);
+
+    // Finishes every queued task, then joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void(size_t)> task);
+
+    // Runs task(worker_index, item_index) for every item in [0, num_items), returning once they're all done.
+    // Don't call this from one of this pool's own tasks, since it blocks waiting on the other workers.
+    void run_all(size_t num_items, const std::function<void(size_t, size_t)>& task);
+
+    size_t size() const {
+        return _workers.size();
+    }
+
+private:
+    std::vector<std::thread> _workers;
+    std::deque<std::function<void(size_t)>> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _ready;
+    bool _stopping;
+
+    void run(size_t worker_index);
+};